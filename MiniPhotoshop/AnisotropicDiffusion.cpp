@@ -0,0 +1,151 @@
+#include "AnisotropicDiffusion.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	const int TileWidth = 256;
+	const int TileHeight = 64;
+	// Iterations per pass over the image, which is also the halo of a tile.
+	const int BlockIterations = 4;
+
+	using DiffusionRow = void (*)(const float*, const float*, const float*, float*, size_t, int, float, float);
+
+	// Per-thread ping-pong copies of one tile and its halo, surrounded by a
+	// one pixel frame for the stencil to read.
+	class DiffusionTile {
+	public:
+		DiffusionTile(int width, int height, DiffusionRow diffusionRow, int conduction, float inverseKappaSquared, float lambda)
+			: width(width), height(height), diffusionRow(diffusionRow), conduction(conduction),
+			inverseKappaSquared(inverseKappaSquared), lambda(lambda),
+			front(static_cast<size_t>(TileWidth + 2 * BlockIterations + 2) * (TileHeight + 2 * BlockIterations + 2)),
+			back(front.size()) {
+		}
+
+		// `iterations` steps of the tile at (x0, y0), read from `in` and
+		// stored to `out`.
+		void run(const float* in, float* out, int x0, int y0, int iterations) {
+			const int x1 = std::min(x0 + TileWidth, width);
+			const int y1 = std::min(y0 + TileHeight, height);
+			const int rx0 = std::max(x0 - iterations, 0);
+			const int rx1 = std::min(x1 + iterations, width);
+			const int ry0 = std::max(y0 - iterations, 0);
+			const int ry1 = std::min(y1 + iterations, height);
+			const int cols = rx1 - rx0;
+			const int rows = ry1 - ry0;
+			const size_t stride = static_cast<size_t>(cols) + 2;
+
+			for (int j = -1; j <= rows; ++j) {
+				const int sy = std::min(std::max(ry0 + j, 0), height - 1);
+				const float* source = in + static_cast<size_t>(sy) * width;
+				float* target = front.data() + static_cast<size_t>(j + 1) * stride;
+				target[0] = source[std::max(rx0 - 1, 0)];
+				std::copy(source + rx0, source + rx1, target + 1);
+				target[cols + 1] = source[std::min(rx1, width - 1)];
+			}
+			std::copy(front.begin(), front.begin() + (rows + 2) * stride, back.begin());
+
+			for (int it = 0; it < iterations; ++it) {
+				for (int j = 1; j <= rows; ++j) {
+					const float* row = front.data() + j * stride + 1;
+					diffusionRow(row - stride, row, row + stride, back.data() + j * stride + 1, cols,
+						conduction, inverseKappaSquared, lambda);
+				}
+				// The frame on the image border repeats the edge, so no flux
+				// crosses it. Elsewhere the frame goes stale, which only
+				// reaches one more pixel of the halo per iteration.
+				float* pixels = back.data();
+				for (int j = 1; j <= rows; ++j) {
+					if (rx0 == 0) pixels[j * stride] = pixels[j * stride + 1];
+					if (rx1 == width) pixels[j * stride + cols + 1] = pixels[j * stride + cols];
+				}
+				if (ry0 == 0) std::copy(pixels + stride, pixels + 2 * stride, pixels);
+				if (ry1 == height) std::copy(pixels + rows * stride, pixels + (rows + 1) * stride, pixels + (rows + 1) * stride);
+				std::swap(front, back);
+			}
+
+			for (int y = y0; y < y1; ++y) {
+				const float* row = front.data() + (y - ry0 + 1) * stride + (x0 - rx0 + 1);
+				std::copy(row, row + (x1 - x0), out + static_cast<size_t>(y) * width + x0);
+			}
+		}
+
+	private:
+		int width;
+		int height;
+		DiffusionRow diffusionRow;
+		int conduction;
+		float inverseKappaSquared;
+		float lambda;
+		std::vector<float> front;
+		std::vector<float> back;
+	};
+
+}
+
+const char* diffusionConductionName(DiffusionConduction conduction) {
+	switch (conduction) {
+	case DiffusionConduction::Exponential: return "Exponential";
+	case DiffusionConduction::Lorentzian: return "Lorentzian";
+	case DiffusionConduction::Tukey: return "Tukey biweight";
+	default: return "Unknown";
+	}
+}
+
+void anisotropicDiffusion(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	const DiffusionParameters& params) {
+	if (width <= 0 || height <= 0) return;
+	planes = std::min(planes, channels);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	for (int c = planes; c < channels; ++c) {
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = src[i * channels + c];
+	}
+	if (planes <= 0) return;
+
+	const int iterations = std::max(params.iterations, 0);
+	const float kappa = std::max(params.kappa, 0.01f);
+	const float lambda = std::min(std::max(params.lambda, 0.0f), 0.25f);
+	const int conduction = std::min(std::max(static_cast<int>(params.conduction), 0), static_cast<int>(DiffusionConduction::Count) - 1);
+	const DiffusionRow diffusionRow = kernels().diffusionRow;
+	const int tilesX = (width + TileWidth - 1) / TileWidth;
+	const int tilesY = (height + TileHeight - 1) / TileHeight;
+	const int tiles = tilesX * tilesY;
+
+	std::vector<float> front(pixelCount);
+	std::vector<float> back(pixelCount);
+
+#pragma omp parallel
+	{
+		DiffusionTile tile(width, height, diffusionRow, conduction, 1.0f / (kappa * kappa), lambda);
+
+		for (int c = 0; c < planes; ++c) {
+#pragma omp for
+			for (int y = 0; y < height; ++y) {
+				const unsigned char* row = src + static_cast<size_t>(y) * width * channels + c;
+				float* out = front.data() + static_cast<size_t>(y) * width;
+				for (int x = 0; x < width; ++x) out[x] = row[static_cast<size_t>(x) * channels];
+			}
+
+			float* in = front.data();
+			float* out = back.data();
+			for (int done = 0; done < iterations; done += BlockIterations) {
+				const int steps = std::min(BlockIterations, iterations - done);
+#pragma omp for schedule(dynamic)
+				for (int t = 0; t < tiles; ++t) {
+					tile.run(in, out, (t % tilesX) * TileWidth, (t / tilesX) * TileHeight, steps);
+				}
+				std::swap(in, out);
+			}
+
+#pragma omp for
+			for (int y = 0; y < height; ++y) {
+				const float* row = in + static_cast<size_t>(y) * width;
+				unsigned char* target = dst + static_cast<size_t>(y) * width * channels + c;
+				for (int x = 0; x < width; ++x) {
+					target[static_cast<size_t>(x) * channels] = static_cast<unsigned char>(std::min(std::max(row[x] + 0.5f, 0.0f), 255.0f));
+				}
+			}
+		}
+	}
+}
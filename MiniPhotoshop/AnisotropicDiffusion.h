@@ -0,0 +1,35 @@
+#ifndef ANISOTROPIC_DIFFUSION_H
+#define ANISOTROPIC_DIFFUSION_H
+
+enum class DiffusionConduction {
+    // exp(-(d / kappa)^2): favours high-contrast edges over low-contrast ones.
+    Exponential = 0,
+    // 1 / (1 + (d / kappa)^2): favours wide regions over smaller ones.
+    Lorentzian,
+    // Tukey's biweight: stops completely at d = kappa, so edges stay sharper.
+    Tukey,
+    Count
+};
+
+const char* diffusionConductionName(DiffusionConduction conduction);
+
+struct DiffusionParameters {
+    int iterations{ 10 };
+    // Differences around kappa levels are edges, smaller ones get smoothed.
+    float kappa{ 15.0f };
+    // Step size, at most 0.25 for stability.
+    float lambda{ 0.25f };
+    DiffusionConduction conduction{ DiffusionConduction::Exponential };
+};
+
+// Perona-Malik diffusion of the first `planes` channels of interleaved
+// 8-bit pixels, each on its own; the rest are copied. No flux crosses the
+// image border. Works on two float planes allocated once per call, and runs
+// several iterations per tile while the tile is in cache: a tile is loaded
+// with a halo as wide as the iterations, which shrinks by one pixel per
+// iteration. The stencil rows go through the dispatched SIMD kernels and the
+// tiles run in parallel.
+void anisotropicDiffusion(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    const DiffusionParameters& params);
+
+#endif // ANISOTROPIC_DIFFUSION_H
@@ -0,0 +1,194 @@
+#include "BilateralGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	// Empty cells around the data, so the blur never needs bounds checks
+	// and slicing never reads outside the grid.
+	const int Pad = 2;
+	// Color sums for up to three channels and the pixel count.
+	const int CellFloats = 4;
+	const size_t Chunk = 256;
+
+	struct Grid {
+		int width{ 0 };
+		int height{ 0 };
+		int depth{ 0 };
+		float cellSize{ 1.0f };
+		float levelSize{ 1.0f };
+		std::vector<float> cells;
+
+		float* at(int gx, int gy, int gz) {
+			return cells.data() + ((static_cast<size_t>(gy) * width + gx) * depth + gz) * CellFloats;
+		}
+	};
+
+	int cellCount(float size, int extent) {
+		return static_cast<int>((extent - 1) / size + 0.5f) + 1 + 2 * Pad;
+	}
+
+	Grid makeGrid(int width, int height, float sigmaSpatial, float sigmaRange) {
+		Grid grid;
+		grid.cellSize = std::max(sigmaSpatial, 1.0f);
+		grid.levelSize = std::max(sigmaRange, 1.0f);
+		grid.depth = cellCount(grid.levelSize, 256);
+		for (;;) {
+			grid.width = cellCount(grid.cellSize, width);
+			grid.height = cellCount(grid.cellSize, height);
+			const long long cells = static_cast<long long>(grid.width) * grid.height * grid.depth;
+			if (cells <= MaxBilateralGridCells) break;
+			grid.cellSize *= std::max(std::sqrt(static_cast<float>(cells) / MaxBilateralGridCells), 1.05f);
+		}
+		grid.cells.assign(static_cast<size_t>(grid.width) * grid.height * grid.depth * CellFloats, 0.0f);
+		return grid;
+	}
+
+	// Nearest-cell splat. Every grid row is owned by one task and only
+	// reads the pixel rows that round to it, so no two tasks write the same
+	// cell.
+	void splat(Grid& grid, const unsigned char* data, int width, int height, int channels, int colors, const unsigned char* guide) {
+		std::vector<int> columnCell(width);
+		for (int x = 0; x < width; ++x) {
+			columnCell[x] = static_cast<int>(x / grid.cellSize + 0.5f) + Pad;
+		}
+		int levelCell[256];
+		for (int v = 0; v < 256; ++v) {
+			levelCell[v] = static_cast<int>(v / grid.levelSize + 0.5f) + Pad;
+		}
+		std::vector<int> firstRow(grid.height + 1, height);
+		for (int y = height - 1; y >= 0; --y) {
+			firstRow[static_cast<int>(y / grid.cellSize + 0.5f) + Pad] = y;
+		}
+		for (int gy = grid.height - 1; gy > 0; --gy) {
+			firstRow[gy - 1] = std::min(firstRow[gy - 1], firstRow[gy]);
+		}
+
+#pragma omp parallel for schedule(dynamic)
+		for (int gy = Pad; gy < grid.height - Pad; ++gy) {
+			for (int y = firstRow[gy]; y < firstRow[gy + 1]; ++y) {
+				const unsigned char* row = data + static_cast<size_t>(y) * width * channels;
+				const unsigned char* levels = guide + static_cast<size_t>(y) * width;
+				for (int x = 0; x < width; ++x) {
+					float* cell = grid.at(columnCell[x], gy, levelCell[levels[x]]);
+					const unsigned char* p = row + static_cast<size_t>(x) * channels;
+					for (int c = 0; c < colors; ++c) cell[c] += p[c];
+					cell[3] += 1.0f;
+				}
+			}
+		}
+	}
+
+	// [1 4 6 4 1] / 16 along the middle axis of the cells viewed as
+	// [outer][length][inner] floats, in place. Each task keeps the two
+	// lines before the current one, since those are already overwritten.
+	void blurAxis(float* cells, size_t outer, int length, size_t inner) {
+		const size_t chunks = (inner + Chunk - 1) / Chunk;
+		const long long tasks = static_cast<long long>(outer * chunks);
+
+#pragma omp parallel
+		{
+			std::vector<float> history(3 * Chunk);
+			const std::vector<float> zeros(Chunk, 0.0f);
+
+#pragma omp for schedule(static)
+			for (long long t = 0; t < tasks; ++t) {
+				const size_t begin = static_cast<size_t>(t % chunks) * Chunk;
+				const size_t count = std::min(Chunk, inner - begin);
+				float* base = cells + static_cast<size_t>(t / chunks) * length * inner + begin;
+				float* before2 = history.data();
+				float* before1 = before2 + Chunk;
+				float* current = before1 + Chunk;
+				std::fill(before2, before2 + 2 * Chunk, 0.0f);
+
+				for (int i = 0; i < length; ++i) {
+					float* line = base + static_cast<size_t>(i) * inner;
+					const float* after1 = i + 1 < length ? line + inner : zeros.data();
+					const float* after2 = i + 2 < length ? line + 2 * inner : zeros.data();
+					std::copy(line, line + count, current);
+					for (size_t k = 0; k < count; ++k) {
+						line[k] = (before2[k] + after2[k] + 4.0f * (before1[k] + after1[k]) + 6.0f * current[k]) * (1.0f / 16.0f);
+					}
+					float* oldest = before2;
+					before2 = before1;
+					before1 = current;
+					current = oldest;
+				}
+			}
+		}
+	}
+
+	struct Sample {
+		int cell;
+		float fraction;
+	};
+
+	Sample sampleAt(float position) {
+		const int cell = static_cast<int>(position);
+		return { cell, position - cell };
+	}
+
+	void slice(Grid& grid, unsigned char* data, int width, int height, int channels, int colors, const unsigned char* guide) {
+		std::vector<Sample> columns(width);
+		for (int x = 0; x < width; ++x) {
+			columns[x] = sampleAt(x / grid.cellSize + Pad);
+		}
+		Sample levels[256];
+		for (int v = 0; v < 256; ++v) {
+			levels[v] = sampleAt(v / grid.levelSize + Pad);
+		}
+		const size_t stepX = static_cast<size_t>(grid.depth) * CellFloats;
+		const size_t stepY = stepX * grid.width;
+
+#pragma omp parallel for schedule(dynamic, 16)
+		for (int y = 0; y < height; ++y) {
+			const Sample sy = sampleAt(y / grid.cellSize + Pad);
+			unsigned char* row = data + static_cast<size_t>(y) * width * channels;
+			const unsigned char* rowLevels = guide + static_cast<size_t>(y) * width;
+			for (int x = 0; x < width; ++x) {
+				const Sample sx = columns[x];
+				const Sample sz = levels[rowLevels[x]];
+				const float* cell = grid.at(sx.cell, sy.cell, sz.cell);
+
+				float value[CellFloats] = {};
+				const float wz[2] = { 1.0f - sz.fraction, sz.fraction };
+				for (int dy = 0; dy < 2; ++dy) {
+					const float wy = dy ? sy.fraction : 1.0f - sy.fraction;
+					for (int dx = 0; dx < 2; ++dx) {
+						const float wxy = wy * (dx ? sx.fraction : 1.0f - sx.fraction);
+						const float* corner = cell + dy * stepY + dx * stepX;
+						for (int dz = 0; dz < 2; ++dz) {
+							const float w = wxy * wz[dz];
+							for (int c = 0; c < CellFloats; ++c) value[c] += w * corner[dz * CellFloats + c];
+						}
+					}
+				}
+
+				if (value[3] <= 0.0f) continue;
+				const float normalize = 1.0f / value[3];
+				unsigned char* p = row + static_cast<size_t>(x) * channels;
+				for (int c = 0; c < colors; ++c) {
+					p[c] = static_cast<unsigned char>(std::min(value[c] * normalize + 0.5f, 255.0f));
+				}
+			}
+		}
+	}
+
+}
+
+void bilateralGrid(unsigned char* data, int width, int height, int channels, const unsigned char* guide,
+	float sigmaSpatial, float sigmaRange) {
+	if (width <= 0 || height <= 0) return;
+	const int colors = std::min(channels, 3);
+
+	Grid grid = makeGrid(width, height, sigmaSpatial, sigmaRange);
+	splat(grid, data, width, height, channels, colors, guide);
+
+	const size_t cellStride = static_cast<size_t>(grid.depth) * CellFloats;
+	blurAxis(grid.cells.data(), 1, grid.height, grid.width * cellStride);
+	blurAxis(grid.cells.data(), grid.height, grid.width, cellStride);
+	blurAxis(grid.cells.data(), static_cast<size_t>(grid.height) * grid.width, grid.depth, CellFloats);
+
+	slice(grid, data, width, height, channels, colors, guide);
+}
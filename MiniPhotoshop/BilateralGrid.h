@@ -0,0 +1,19 @@
+#ifndef BILATERAL_GRID_H
+#define BILATERAL_GRID_H
+
+// Grids larger than this many cells sample space more coarsely than
+// sigmaSpatial, which bounds the memory at 16 bytes per cell.
+const long long MaxBilateralGridCells = 1LL << 23;
+
+// Bilateral filter of interleaved 8-bit pixels in place with a bilateral
+// grid (Paris-Durand): the color channels are splatted into cells of
+// sigmaSpatial pixels by sigmaRange guide levels, the grid is blurred with
+// a [1 4 6 4 1] / 16 kernel along all three axes, and every pixel is sliced
+// back trilinearly at its own position and guide value. Edges are those of
+// `guide`, a width x height plane, usually the luma of `data`. The grid
+// shrinks as sigmaSpatial grows, so the cost is nearly independent of it.
+// Alpha is left untouched; sigmas below 1 are raised to 1.
+void bilateralGrid(unsigned char* data, int width, int height, int channels, const unsigned char* guide,
+    float sigmaSpatial, float sigmaRange);
+
+#endif // BILATERAL_GRID_H
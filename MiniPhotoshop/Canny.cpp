@@ -0,0 +1,291 @@
+#include "Canny.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+
+	enum Label : unsigned char {
+		NotEdge = 0,
+		WeakEdge = 1,
+		StrongEdge = 2
+	};
+
+	// Integer Gaussian taps that sum to exactly 1 << 10.
+	std::vector<int> gaussianTaps(float sigma, int& radius) {
+		radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+		std::vector<float> weights(2 * radius + 1);
+		float sum = 0.0f;
+		for (int k = -radius; k <= radius; ++k) {
+			weights[k + radius] = std::exp(-(k * k) / (2.0f * sigma * sigma));
+			sum += weights[k + radius];
+		}
+
+		std::vector<int> taps(weights.size());
+		int total = 0;
+		for (size_t k = 0; k < weights.size(); ++k) {
+			taps[k] = static_cast<int>(std::lround(weights[k] / sum * 1024.0f));
+			total += taps[k];
+		}
+		taps[radius] += 1024 - total;
+		return taps;
+	}
+
+	// One row of the separable Gaussian: vertical taps into `columnSums`,
+	// then horizontal taps with the border rule at both ends.
+	void smoothRow(const unsigned char* gray, int width, int height, int y, const std::vector<int>& taps, int radius,
+		BorderMode border, int* columnSums, unsigned char* out) {
+		std::fill(columnSums, columnSums + width, 0);
+		for (int k = -radius; k <= radius; ++k) {
+			const int sy = borderCoordinate(y + k, height, border);
+			if (sy < 0) continue;
+			const unsigned char* row = gray + static_cast<size_t>(sy) * width;
+			const int weight = taps[k + radius];
+			for (int x = 0; x < width; ++x) {
+				columnSums[x] += weight * row[x];
+			}
+		}
+
+		const int interiorBegin = std::min(radius, width);
+		const int interiorEnd = std::max(interiorBegin, width - radius);
+		auto borderPixel = [&](int x) {
+			int sum = 0;
+			for (int k = -radius; k <= radius; ++k) {
+				const int sx = borderCoordinate(x + k, width, border);
+				if (sx >= 0) sum += taps[k + radius] * columnSums[sx];
+			}
+			out[x] = static_cast<unsigned char>((sum + (1 << 19)) >> 20);
+		};
+
+		for (int x = 0; x < interiorBegin; ++x) borderPixel(x);
+		for (int x = interiorBegin; x < interiorEnd; ++x) {
+			const int* window = columnSums + x - radius;
+			int sum = 0;
+			for (int k = 0; k <= 2 * radius; ++k) {
+				sum += taps[k] * window[k];
+			}
+			out[x] = static_cast<unsigned char>((sum + (1 << 19)) >> 20);
+		}
+		for (int x = interiorEnd; x < width; ++x) borderPixel(x);
+	}
+
+	// Non-maximum suppression and double threshold for one row. Row pointers
+	// are null above the first and below the last image row. Squared
+	// magnitudes are compared so everything stays in integers.
+	void suppressRow(const short* const gxRows[3], const short* const gyRows[3], int width, int low2, int high2, unsigned char* labels) {
+		auto magnitude2 = [&](int r, int x) {
+			if (!gxRows[r] || x < 0 || x >= width) return 0;
+			const int gx = gxRows[r][x], gy = gyRows[r][x];
+			return gx * gx + gy * gy;
+		};
+
+		for (int x = 0; x < width; ++x) {
+			const int gx = gxRows[1][x], gy = gyRows[1][x];
+			const int m = gx * gx + gy * gy;
+			unsigned char label = NotEdge;
+			if (m >= low2 && m > 0) {
+				const int ax = std::abs(gx), ay = std::abs(gy);
+				int n1, n2;
+				// tan(22.5 deg) = 0.4142, tan(67.5 deg) = 2.4142
+				if (ay * 10000 <= ax * 4142) {
+					n1 = magnitude2(1, x - 1);
+					n2 = magnitude2(1, x + 1);
+				}
+				else if (ay * 10000 >= ax * 24142) {
+					n1 = magnitude2(0, x);
+					n2 = magnitude2(2, x);
+				}
+				else if ((gx > 0) == (gy > 0)) {
+					n1 = magnitude2(0, x - 1);
+					n2 = magnitude2(2, x + 1);
+				}
+				else {
+					n1 = magnitude2(0, x + 1);
+					n2 = magnitude2(2, x - 1);
+				}
+				if (m > n1 && m >= n2) {
+					label = m >= high2 ? StrongEdge : WeakEdge;
+				}
+			}
+			labels[x] = label;
+		}
+	}
+
+	int squaredThreshold(float threshold) {
+		return static_cast<int>(std::ceil(std::max(threshold, 0.0f) * std::max(threshold, 0.0f)));
+	}
+
+	// Promotes weak pixels connected to strong ones. Every strip floods its
+	// own rows with an explicit stack; neighbours in another strip are posted
+	// to that strip's inbox and picked up in the next round, so no thread
+	// ever touches rows it does not own.
+	void hysteresis(unsigned char* labels, int width, int height) {
+		const int stripCount = (height + StripRows - 1) / StripRows;
+		std::vector<std::vector<size_t>> inbox(stripCount), toPrevious(stripCount), toNext(stripCount);
+		bool firstRound = true;
+
+		while (true) {
+#pragma omp parallel for schedule(dynamic)
+			for (int strip = 0; strip < stripCount; ++strip) {
+				const int y0 = strip * StripRows;
+				const int y1 = std::min(height, y0 + StripRows);
+				std::vector<size_t> stack;
+
+				if (firstRound) {
+					for (size_t idx = static_cast<size_t>(y0) * width; idx < static_cast<size_t>(y1) * width; ++idx) {
+						if (labels[idx] == StrongEdge) stack.push_back(idx);
+					}
+				}
+				else {
+					for (size_t idx : inbox[strip]) {
+						if (labels[idx] == WeakEdge) {
+							labels[idx] = StrongEdge;
+							stack.push_back(idx);
+						}
+					}
+					inbox[strip].clear();
+				}
+
+				while (!stack.empty()) {
+					const size_t idx = stack.back();
+					stack.pop_back();
+					const int x = static_cast<int>(idx % width);
+					const int y = static_cast<int>(idx / width);
+					for (int dy = -1; dy <= 1; ++dy) {
+						const int ny = y + dy;
+						if (ny < 0 || ny >= height) continue;
+						for (int dx = -1; dx <= 1; ++dx) {
+							const int nx = x + dx;
+							if ((dx == 0 && dy == 0) || nx < 0 || nx >= width) continue;
+							const size_t neighbour = static_cast<size_t>(ny) * width + nx;
+							if (ny < y0) {
+								toPrevious[strip].push_back(neighbour);
+							}
+							else if (ny >= y1) {
+								toNext[strip].push_back(neighbour);
+							}
+							else if (labels[neighbour] == WeakEdge) {
+								labels[neighbour] = StrongEdge;
+								stack.push_back(neighbour);
+							}
+						}
+					}
+				}
+			}
+			firstRound = false;
+
+			bool pending = false;
+			for (int strip = 0; strip < stripCount; ++strip) {
+				if (!toPrevious[strip].empty()) {
+					inbox[strip - 1].insert(inbox[strip - 1].end(), toPrevious[strip].begin(), toPrevious[strip].end());
+					toPrevious[strip].clear();
+					pending = true;
+				}
+				if (!toNext[strip].empty()) {
+					inbox[strip + 1].insert(inbox[strip + 1].end(), toNext[strip].begin(), toNext[strip].end());
+					toNext[strip].clear();
+					pending = true;
+				}
+			}
+			if (!pending) break;
+		}
+
+		const long long total = static_cast<long long>(width) * height;
+#pragma omp parallel for
+		for (long long i = 0; i < total; ++i) {
+			labels[i] = labels[i] == StrongEdge ? 255 : 0;
+		}
+	}
+
+}
+
+void cannyEdges(const unsigned char* gray, int width, int height, const CannyParameters& params, BorderMode border, unsigned char* edges) {
+	if (width <= 0 || height <= 0) return;
+	if (params.sigma <= 0.0f) {
+		std::vector<short> gx(static_cast<size_t>(width) * height), gy(gx.size());
+		gradient3x3(gray, width, height, 2, border, gx.data(), gy.data());
+		cannyEdgesFromGradients(gx.data(), gy.data(), width, height, params, edges);
+		return;
+	}
+
+	int radius = 0;
+	const std::vector<int> taps = gaussianTaps(params.sigma, radius);
+	const int low2 = squaredThreshold(params.lowThreshold);
+	const int high2 = std::max(low2, squaredThreshold(params.highThreshold));
+	const int stripCount = (height + StripRows - 1) / StripRows;
+
+#pragma omp parallel
+	{
+		// Smoothed rows y0 - 2 .. y1 + 1 and gradient rows y0 - 1 .. y1 of the current strip.
+		std::vector<int> columnSums(width);
+		std::vector<unsigned char> smoothed(static_cast<size_t>(StripRows + 4) * width);
+		std::vector<short> gx(static_cast<size_t>(StripRows + 2) * width), gy(gx.size());
+
+#pragma omp for schedule(dynamic)
+		for (int strip = 0; strip < stripCount; ++strip) {
+			const int y0 = strip * StripRows;
+			const int y1 = std::min(height, y0 + StripRows);
+
+			for (int s = y0 - 2; s <= y1 + 1; ++s) {
+				unsigned char* out = smoothed.data() + static_cast<size_t>(s - (y0 - 2)) * width;
+				const int sy = borderCoordinate(s, height, border);
+				if (sy < 0) {
+					std::fill(out, out + width, 0);
+				}
+				else {
+					smoothRow(gray, width, height, sy, taps, radius, border, columnSums.data(), out);
+				}
+			}
+
+			const int g0 = std::max(y0 - 1, 0);
+			const int g1 = std::min(y1 + 1, height);
+			for (int g = g0; g < g1; ++g) {
+				const unsigned char* rows[3];
+				for (int k = 0; k < 3; ++k) {
+					rows[k] = smoothed.data() + static_cast<size_t>(g + k - 1 - (y0 - 2)) * width;
+				}
+				const size_t offset = static_cast<size_t>(g - (y0 - 1)) * width;
+				gradientRow3x3(rows, width, 2, border, gx.data() + offset, gy.data() + offset);
+			}
+
+			for (int y = y0; y < y1; ++y) {
+				const short* gxRows[3];
+				const short* gyRows[3];
+				for (int k = 0; k < 3; ++k) {
+					const int g = y + k - 1;
+					const bool inside = g >= 0 && g < height;
+					const size_t offset = static_cast<size_t>(g - (y0 - 1)) * width;
+					gxRows[k] = inside ? gx.data() + offset : nullptr;
+					gyRows[k] = inside ? gy.data() + offset : nullptr;
+				}
+				suppressRow(gxRows, gyRows, width, low2, high2, edges + static_cast<size_t>(y) * width);
+			}
+		}
+	}
+
+	hysteresis(edges, width, height);
+}
+
+void cannyEdgesFromGradients(const short* gx, const short* gy, int width, int height, const CannyParameters& params, unsigned char* edges) {
+	if (width <= 0 || height <= 0) return;
+	const int low2 = squaredThreshold(params.lowThreshold);
+	const int high2 = std::max(low2, squaredThreshold(params.highThreshold));
+
+#pragma omp parallel for
+	for (int y = 0; y < height; ++y) {
+		const short* gxRows[3];
+		const short* gyRows[3];
+		for (int k = 0; k < 3; ++k) {
+			const int g = y + k - 1;
+			const bool inside = g >= 0 && g < height;
+			gxRows[k] = inside ? gx + static_cast<size_t>(g) * width : nullptr;
+			gyRows[k] = inside ? gy + static_cast<size_t>(g) * width : nullptr;
+		}
+		suppressRow(gxRows, gyRows, width, low2, high2, edges + static_cast<size_t>(y) * width);
+	}
+
+	hysteresis(edges, width, height);
+}
@@ -0,0 +1,23 @@
+#ifndef CANNY_H
+#define CANNY_H
+
+#include "Stencil3x3.h"
+
+struct CannyParameters {
+    // Gaussian pre-smoothing, 0 skips it.
+    float sigma{ 1.4f };
+    // Hysteresis thresholds on the Sobel gradient magnitude.
+    float lowThreshold{ 40.0f };
+    float highThreshold{ 100.0f };
+};
+
+// Writes 255 for edge pixels and 0 elsewhere into `edges` (width * height).
+// Smoothing, gradients and non-maximum suppression run on horizontal strips,
+// so apart from the output only a few rows per thread are alive at any time.
+void cannyEdges(const unsigned char* gray, int width, int height, const CannyParameters& params, BorderMode border, unsigned char* edges);
+
+// Same pipeline starting from already computed Sobel derivatives; the
+// smoothing step is skipped.
+void cannyEdgesFromGradients(const short* gx, const short* gy, int width, int height, const CannyParameters& params, unsigned char* edges);
+
+#endif // CANNY_H
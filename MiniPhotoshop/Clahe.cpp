@@ -0,0 +1,169 @@
+#include "Clahe.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	const int Bins = 256;
+	const int WeightOne = 256;
+
+	// Pixel range [begin, end) of tile t when size is split into count tiles.
+	int tileBegin(int t, int size, int count) {
+		return static_cast<int>(static_cast<long long>(t) * size / count);
+	}
+
+	void clipHistogram(std::array<int, Bins>& histogram, int clip) {
+		int excess = 0;
+		for (int& bin : histogram) {
+			if (bin > clip) {
+				excess += bin - clip;
+				bin = clip;
+			}
+		}
+
+		const int batch = excess / Bins;
+		int residual = excess - batch * Bins;
+		for (int& bin : histogram) {
+			bin += batch;
+		}
+		if (residual > 0) {
+			const int step = std::max(Bins / residual, 1);
+			for (int i = 0; i < Bins && residual > 0; i += step, --residual) {
+				++histogram[i];
+			}
+		}
+	}
+
+	// Equalization LUT of one tile of one channel, sampled every `step` bytes.
+	void tileLut(const unsigned char* src, int width, int step, int x0, int x1, int y0, int y1, float clipLimit, unsigned char* lut) {
+		std::array<int, Bins> histogram{ 0 };
+		for (int y = y0; y < y1; ++y) {
+			const unsigned char* row = src + (static_cast<size_t>(y) * width + x0) * step;
+			for (int x = x0; x < x1; ++x, row += step) {
+				++histogram[*row];
+			}
+		}
+
+		const int area = (x1 - x0) * (y1 - y0);
+		if (clipLimit > 0.0f) {
+			clipHistogram(histogram, std::max(1, static_cast<int>(clipLimit * area / Bins)));
+		}
+
+		long long cdf = 0;
+		for (int v = 0; v < Bins; ++v) {
+			cdf += histogram[v];
+			lut[v] = static_cast<unsigned char>(std::min<long long>(255, (cdf * 255 + area / 2) / area));
+		}
+	}
+
+	// Neighbouring tile centers and the 8-bit weight of the second one for
+	// every coordinate along one axis.
+	struct AxisWeights {
+		std::vector<int> first;
+		std::vector<int> second;
+		std::vector<int> weight;
+	};
+
+	AxisWeights axisWeights(int size, int tiles) {
+		AxisWeights axis;
+		axis.first.resize(size);
+		axis.second.resize(size);
+		axis.weight.resize(size);
+		for (int i = 0; i < size; ++i) {
+			const float position = (i + 0.5f) * tiles / size - 0.5f;
+			int first = static_cast<int>(std::floor(position));
+			int weight = static_cast<int>(std::lround((position - first) * WeightOne));
+			if (first < 0) {
+				first = 0;
+				weight = 0;
+			}
+			else if (first >= tiles - 1) {
+				first = tiles - 1;
+				weight = 0;
+			}
+			axis.first[i] = first;
+			axis.second[i] = std::min(first + 1, tiles - 1);
+			axis.weight[i] = weight;
+		}
+		return axis;
+	}
+
+	// Bilinear blend of the four surrounding tile LUTs for one row of values
+	// read every `step` bytes. `top` and `bottom` point at the first LUT of
+	// the two tile rows around the image row.
+	void interpolateRow(const unsigned char* values, int step, int width, const AxisWeights& columns,
+		const unsigned char* top, const unsigned char* bottom, int rowWeight, unsigned char* out) {
+		const int* first = columns.first.data();
+		const int* second = columns.second.data();
+		const int* weight = columns.weight.data();
+		for (int x = 0; x < width; ++x) {
+			const int v = values[static_cast<size_t>(x) * step];
+			const int a = first[x] * Bins + v;
+			const int b = second[x] * Bins + v;
+			const int w = weight[x];
+			const int upper = top[a] * (WeightOne - w) + top[b] * w;
+			const int lower = bottom[a] * (WeightOne - w) + bottom[b] * w;
+			out[x] = static_cast<unsigned char>((upper * (WeightOne - rowWeight) + lower * rowWeight + (1 << 15)) >> 16);
+		}
+	}
+
+}
+
+void applyClahe(unsigned char* data, int width, int height, int channels, const unsigned char* luma, const ClaheParameters& params) {
+	if (!data || width <= 0 || height <= 0) return;
+
+	const int tilesX = std::min(std::max(params.tilesX, 1), width);
+	const int tilesY = std::min(std::max(params.tilesY, 1), height);
+	const bool luminance = params.mode == ClaheMode::Luminance;
+	const int planes = luminance ? 1 : 3;
+	const int tileCount = tilesX * tilesY;
+
+	// luts[(plane * tilesY + ty) * tilesX + tx][v]
+	std::vector<unsigned char> luts(static_cast<size_t>(planes) * tileCount * Bins);
+	const int jobs = planes * tileCount;
+
+#pragma omp parallel for schedule(dynamic)
+	for (int job = 0; job < jobs; ++job) {
+		const int plane = job / tileCount;
+		const int tx = job % tilesX;
+		const int ty = job / tilesX % tilesY;
+		const unsigned char* src = luminance ? luma : data + plane;
+		const int step = luminance ? 1 : channels;
+		tileLut(src, width, step,
+			tileBegin(tx, width, tilesX), tileBegin(tx + 1, width, tilesX),
+			tileBegin(ty, height, tilesY), tileBegin(ty + 1, height, tilesY),
+			params.clipLimit, luts.data() + static_cast<size_t>(job) * Bins);
+	}
+
+	const AxisWeights columns = axisWeights(width, tilesX);
+	const AxisWeights rows = axisWeights(height, tilesY);
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> equalized(width);
+#pragma omp for
+		for (int y = 0; y < height; ++y) {
+			unsigned char* pixels = data + static_cast<size_t>(y) * width * channels;
+			for (int plane = 0; plane < planes; ++plane) {
+				const unsigned char* planeLuts = luts.data() + static_cast<size_t>(plane) * tileCount * Bins;
+				const unsigned char* top = planeLuts + static_cast<size_t>(rows.first[y]) * tilesX * Bins;
+				const unsigned char* bottom = planeLuts + static_cast<size_t>(rows.second[y]) * tilesX * Bins;
+
+				if (luminance) {
+					const unsigned char* lumaRow = luma + static_cast<size_t>(y) * width;
+					interpolateRow(lumaRow, 1, width, columns, top, bottom, rows.weight[y], equalized.data());
+					kernels().replaceLuma(pixels, equalized.data(), width, channels);
+				}
+				else {
+					interpolateRow(pixels + plane, channels, width, columns, top, bottom, rows.weight[y], equalized.data());
+					for (int x = 0; x < width; ++x) {
+						pixels[static_cast<size_t>(x) * channels + plane] = equalized[x];
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef CLAHE_H
+#define CLAHE_H
+
+enum class ClaheMode {
+    // Equalizes the luma plane and keeps Cb and Cr (see replaceLuma).
+    Luminance = 0,
+    // Equalizes R, G and B independently.
+    PerChannel,
+    Count
+};
+
+struct ClaheParameters {
+    int tilesX{ 8 };
+    int tilesY{ 8 };
+    // Histogram bins are clipped at clipLimit times the mean bin height and
+    // the excess is spread over all bins. 0 disables clipping.
+    float clipLimit{ 2.0f };
+    ClaheMode mode{ ClaheMode::Luminance };
+};
+
+// Contrast-limited adaptive histogram equalization of interleaved 8-bit
+// pixels in place; alpha is left untouched. `luma` is the luma plane of
+// `data` and is only read in ClaheMode::Luminance.
+void applyClahe(unsigned char* data, int width, int height, int channels, const unsigned char* luma, const ClaheParameters& params);
+
+#endif // CLAHE_H
@@ -0,0 +1,592 @@
+#include "Convolution.h"
+#include "Fft.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+	const int StripRows = 64;
+
+	// Pixels per block. Sums go to a fixed-size local block, so the compiler
+	// vectorizes without proving that out and the sources are disjoint.
+	const size_t BlockSize = 64;
+
+	// out[i] = sum of weights[t] * sources[t][i]. Both passes of the
+	// separable path and the direct path reduce to this. A nonzero Taps
+	// fixes the tap count at compile time and unrolls the tap loop; 0 takes
+	// it from `taps` and skips zero weights instead.
+	template <int Taps>
+	void weightedSum(const float* const* sources, const float* weights, int taps, size_t count, float* out) {
+		const int n = Taps > 0 ? Taps : taps;
+		size_t start = 0;
+		for (; start + BlockSize <= count; start += BlockSize) {
+			float block[BlockSize] = {};
+			for (int t = 0; t < n; ++t) {
+				const float weight = weights[t];
+				if (Taps == 0 && weight == 0.0f) continue;
+				const float* source = sources[t] + start;
+				for (size_t i = 0; i < BlockSize; ++i) {
+					block[i] += weight * source[i];
+				}
+			}
+			std::copy(block, block + BlockSize, out + start);
+		}
+		for (; start < count; ++start) {
+			float sum = 0.0f;
+			for (int t = 0; t < n; ++t) {
+				sum += weights[t] * sources[t][start];
+			}
+			out[start] = sum;
+		}
+	}
+
+	unsigned char toByte(float value) {
+		return static_cast<unsigned char>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+	}
+
+	unsigned char toByte(float value, float offset, ConvolutionOutput output) {
+		value += offset;
+		return toByte(output == ConvolutionOutput::Absolute ? std::abs(value) : value);
+	}
+
+	void storeRow(const float* response, const unsigned char* srcRow, int width, int channels, int planes, float offset, ConvolutionOutput output, unsigned char* dst) {
+		const size_t count = static_cast<size_t>(width) * channels;
+		if (output == ConvolutionOutput::Absolute) {
+			for (size_t i = 0; i < count; ++i) dst[i] = toByte(std::abs(response[i] + offset));
+		}
+		else {
+			for (size_t i = 0; i < count; ++i) dst[i] = toByte(response[i] + offset);
+		}
+		for (int c = planes; c < channels; ++c) {
+			for (int x = 0; x < width; ++x) {
+				dst[static_cast<size_t>(x) * channels + c] = srcRow[static_cast<size_t>(x) * channels + c];
+			}
+		}
+	}
+
+	// 3x3 integer weights that fit the int16 stencil kernels.
+	bool integerStencil(const ConvolutionKernel& kernel, short weights[9]) {
+		if (kernel.width != 3 || kernel.height != 3) return false;
+		int total = 0;
+		for (int i = 0; i < 9; ++i) {
+			const float tap = kernel.taps[i];
+			if (tap != std::round(tap) || std::abs(tap) > 128.0f) return false;
+			weights[i] = static_cast<short>(tap);
+			total += std::abs(weights[i]);
+		}
+		return total <= 128;
+	}
+
+	void convolveStencil(const unsigned char* src, unsigned char* dst, int width, int height, const short weights[9], float offset, BorderMode border, ConvolutionOutput output) {
+		const std::vector<unsigned char> zeroRow(width, 0);
+#pragma omp parallel
+		{
+			std::vector<short> response(width);
+#pragma omp for schedule(dynamic, StripRows)
+			for (int y = 0; y < height; ++y) {
+				const unsigned char* rows[3];
+				for (int k = 0; k < 3; ++k) {
+					rows[k] = borderRow(src, width, height, y + k - 1, border, zeroRow.data());
+				}
+				convolveRow3x3(rows, width, weights, border, response.data());
+				unsigned char* out = dst + static_cast<size_t>(y) * width;
+				for (int x = 0; x < width; ++x) {
+					out[x] = toByte(response[x], offset, output);
+				}
+			}
+		}
+	}
+
+	typedef std::complex<float> Complex;
+
+	const int MinFftTile = 16;
+	const int MaxFftTile = 4096;
+
+	// Transform cost per valid output pixel of a size x size overlap-save
+	// tile, in units of one direct tap, or 0 when the kernel does not fit.
+	double fftTileCost(const ConvolutionKernel& kernel, int size) {
+		const double validWidth = size - kernel.width + 1.0;
+		const double validHeight = size - kernel.height + 1.0;
+		if (validWidth < 1.0 || validHeight < 1.0) return 0.0;
+		// Measured against the direct loops, which break even with the
+		// transforms at about 13x13 taps on a large image.
+		const double TransformWeight = 16.0;
+		return TransformWeight * size * size * std::log2(static_cast<double>(size)) / (validWidth * validHeight);
+	}
+
+	// The cheapest tile per valid pixel. Tiles stop growing once a single
+	// one covers the image, so small images get small transforms.
+	int fftTileSize(const ConvolutionKernel& kernel, int width, int height) {
+		int best = 0;
+		double bestCost = 0.0;
+		for (int size = MinFftTile; size <= MaxFftTile; size *= 2) {
+			const double cost = fftTileCost(kernel, size);
+			if (cost > 0.0 && (best == 0 || cost < bestCost)) {
+				best = size;
+				bestCost = cost;
+			}
+			if (best != 0 && size - kernel.width + 1 >= width && size - kernel.height + 1 >= height) break;
+		}
+		return best;
+	}
+
+	// Overlap-save: every tile transforms size x size input pixels and keeps
+	// the (size - kernel + 1)^2 outputs that the circular wrap does not reach.
+	void convolveFft(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+		const ConvolutionKernel& kernel, int size, BorderMode border, ConvolutionOutput output) {
+		const int bins = size / 2 + 1;
+		const int left = kernel.width / 2;
+		const int above = kernel.height / 2;
+		const int validWidth = size - kernel.width + 1;
+		const int validHeight = size - kernel.height + 1;
+		const RealFftPlan& rowPlan = realFftPlan(size);
+		const FftPlan& columnPlan = fftPlan(size);
+
+		// Kernel spectrum, stored per column bin for the fused column pass.
+		// Flipping the taps around the anchor makes the circular product a
+		// correlation like the other paths; the 1 / size^2 of the two
+		// inverse transforms is folded in.
+		std::vector<Complex> kernelSpectrum(static_cast<size_t>(bins) * size);
+		{
+			const float scale = 1.0f / (static_cast<float>(size) * size);
+			std::vector<float> plane(static_cast<size_t>(size) * size, 0.0f);
+			for (int ky = 0; ky < kernel.height; ++ky) {
+				for (int kx = 0; kx < kernel.width; ++kx) {
+					const int u = (size - (kx - left)) % size;
+					const int v = (size - (ky - above)) % size;
+					plane[static_cast<size_t>(v) * size + u] = kernel.at(kx, ky) * scale;
+				}
+			}
+			std::vector<Complex> rows(static_cast<size_t>(size) * bins), column(size), scratch(size / 2);
+			for (int v = 0; v < size; ++v) {
+				rowPlan.forward(plane.data() + static_cast<size_t>(v) * size, rows.data() + static_cast<size_t>(v) * bins, scratch.data());
+			}
+			for (int u = 0; u < bins; ++u) {
+				for (int v = 0; v < size; ++v) column[v] = rows[static_cast<size_t>(v) * bins + u];
+				columnPlan.forward(column.data());
+				std::copy(column.begin(), column.end(), kernelSpectrum.begin() + static_cast<size_t>(u) * size);
+			}
+		}
+
+		const int tilesX = (width + validWidth - 1) / validWidth;
+		const int tilesY = (height + validHeight - 1) / validHeight;
+		const size_t stride = static_cast<size_t>(width) * channels;
+
+#pragma omp parallel
+		{
+			std::vector<float> tile(static_cast<size_t>(size) * size);
+			std::vector<Complex> spectrum(static_cast<size_t>(size) * bins), column(size), scratch(size / 2);
+			std::vector<float> row(size);
+			std::vector<int> sourceX(size);
+
+#pragma omp for schedule(dynamic)
+			for (int t = 0; t < tilesX * tilesY; ++t) {
+				const int x0 = (t % tilesX) * validWidth;
+				const int y0 = (t / tilesX) * validHeight;
+				const int outWidth = std::min(validWidth, width - x0);
+				const int outHeight = std::min(validHeight, height - y0);
+				for (int lx = 0; lx < size; ++lx) {
+					sourceX[lx] = borderCoordinate(x0 - left + lx, width, border);
+				}
+
+				for (int c = 0; c < channels; ++c) {
+					if (c >= planes) {
+						for (int y = y0; y < y0 + outHeight; ++y) {
+							for (int x = x0; x < x0 + outWidth; ++x) {
+								dst[y * stride + static_cast<size_t>(x) * channels + c] = src[y * stride + static_cast<size_t>(x) * channels + c];
+							}
+						}
+						continue;
+					}
+
+					for (int ly = 0; ly < size; ++ly) {
+						float* out = tile.data() + static_cast<size_t>(ly) * size;
+						const int sy = borderCoordinate(y0 - above + ly, height, border);
+						if (sy < 0) {
+							std::fill(out, out + size, 0.0f);
+						}
+						else {
+							const unsigned char* in = src + sy * stride + c;
+							for (int lx = 0; lx < size; ++lx) {
+								out[lx] = sourceX[lx] < 0 ? 0.0f : in[static_cast<size_t>(sourceX[lx]) * channels];
+							}
+						}
+						rowPlan.forward(out, spectrum.data() + static_cast<size_t>(ly) * bins, scratch.data());
+					}
+
+					// Forward column transform, product and inverse column
+					// transform per bin; only the rows that hold valid
+					// outputs go back into the spectrum.
+					for (int u = 0; u < bins; ++u) {
+						for (int v = 0; v < size; ++v) column[v] = spectrum[static_cast<size_t>(v) * bins + u];
+						columnPlan.forward(column.data());
+						const Complex* k = kernelSpectrum.data() + static_cast<size_t>(u) * size;
+						for (int v = 0; v < size; ++v) column[v] *= k[v];
+						columnPlan.inverse(column.data());
+						for (int ly = above; ly < above + outHeight; ++ly) spectrum[static_cast<size_t>(ly) * bins + u] = column[ly];
+					}
+
+					for (int ly = above; ly < above + outHeight; ++ly) {
+						rowPlan.inverse(spectrum.data() + static_cast<size_t>(ly) * bins, row.data(), scratch.data());
+						unsigned char* out = dst + (y0 + ly - above) * stride + static_cast<size_t>(x0) * channels + c;
+						for (int x = 0; x < outWidth; ++x) {
+							out[static_cast<size_t>(x) * channels] = toByte(row[left + x], kernel.offset, output);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void validate(const ConvolutionKernel& kernel) {
+		if (kernel.width <= 0 || kernel.height <= 0 || kernel.taps.size() != static_cast<size_t>(kernel.width) * kernel.height) {
+			throw std::runtime_error("Malformed convolution kernel");
+		}
+	}
+
+}
+
+void loadPaddedRow(const unsigned char* src, int width, int height, int channels, int y, int left, int right, BorderMode border, float* out) {
+	const size_t count = static_cast<size_t>(width + left + right) * channels;
+	const int sy = borderCoordinate(y, height, border);
+	if (sy < 0) {
+		std::fill(out, out + count, 0.0f);
+		return;
+	}
+
+	const unsigned char* row = src + static_cast<size_t>(sy) * width * channels;
+	float* interior = out + static_cast<size_t>(left) * channels;
+	const size_t rowSize = static_cast<size_t>(width) * channels;
+	for (size_t i = 0; i < rowSize; ++i) {
+		interior[i] = row[i];
+	}
+
+	auto pad = [&](int x) {
+		const int sx = borderCoordinate(x, width, border);
+		float* p = interior + static_cast<std::ptrdiff_t>(x) * channels;
+		for (int c = 0; c < channels; ++c) {
+			p[c] = sx < 0 ? 0.0f : row[static_cast<size_t>(sx) * channels + c];
+		}
+	};
+	for (int x = -left; x < 0; ++x) pad(x);
+	for (int x = width; x < width + right; ++x) pad(x);
+}
+
+// 3, 5 and 7 tap separable passes and 3x3, 5x5 and 7x7 direct kernels
+// get their own unrolled instance.
+void weightedRowSum(const float* const* sources, const float* weights, int taps, size_t count, float* out) {
+	switch (taps) {
+	case 3: weightedSum<3>(sources, weights, taps, count, out); break;
+	case 5: weightedSum<5>(sources, weights, taps, count, out); break;
+	case 7: weightedSum<7>(sources, weights, taps, count, out); break;
+	case 9: weightedSum<9>(sources, weights, taps, count, out); break;
+	case 25: weightedSum<25>(sources, weights, taps, count, out); break;
+	case 49: weightedSum<49>(sources, weights, taps, count, out); break;
+	default: weightedSum<0>(sources, weights, taps, count, out); break;
+	}
+}
+
+std::vector<float> gaussianTaps(int size, float sigma) {
+	size = std::max(size, 1);
+	std::vector<double> profile(size);
+	double sum = 0.0;
+	for (int i = 0; i < size; ++i) {
+		const double d = i - size / 2;
+		profile[i] = std::exp(-d * d / (2.0 * sigma * sigma));
+		sum += profile[i];
+	}
+	std::vector<float> taps(size);
+	for (int i = 0; i < size; ++i) taps[i] = static_cast<float>(profile[i] / sum);
+	return taps;
+}
+
+ConvolutionKernel ConvolutionKernel::box(int size) {
+	size = std::max(size, 1);
+	ConvolutionKernel kernel;
+	kernel.width = size;
+	kernel.height = size;
+	kernel.taps.assign(static_cast<size_t>(size) * size, 1.0f / (size * size));
+	return kernel;
+}
+
+ConvolutionKernel ConvolutionKernel::gaussian(int size, float sigma) {
+	size = std::max(size, 1);
+	const std::vector<float> profile = gaussianTaps(size, sigma);
+
+	ConvolutionKernel kernel;
+	kernel.width = size;
+	kernel.height = size;
+	kernel.taps.resize(static_cast<size_t>(size) * size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			kernel.taps[static_cast<size_t>(y) * size + x] = profile[y] * profile[x];
+		}
+	}
+	return kernel;
+}
+
+ConvolutionKernel ConvolutionKernel::disk(int radius) {
+	radius = std::max(radius, 0);
+	const int size = 2 * radius + 1;
+	ConvolutionKernel kernel;
+	kernel.width = size;
+	kernel.height = size;
+	kernel.taps.resize(static_cast<size_t>(size) * size);
+	// Coverage of each pixel by the disk, approximated by the distance of
+	// its center to the rim.
+	double sum = 0.0;
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			const double d = std::sqrt(static_cast<double>((x - radius) * (x - radius) + (y - radius) * (y - radius)));
+			const double coverage = std::min(std::max(radius + 0.5 - d, 0.0), 1.0);
+			kernel.taps[static_cast<size_t>(y) * size + x] = static_cast<float>(coverage);
+			sum += coverage;
+		}
+	}
+	for (float& tap : kernel.taps) tap = static_cast<float>(tap / sum);
+	return kernel;
+}
+
+const char* convolutionStrategyName(ConvolutionStrategy strategy) {
+	switch (strategy) {
+	case ConvolutionStrategy::Auto: return "Auto";
+	case ConvolutionStrategy::Direct: return "Direct";
+	case ConvolutionStrategy::Separable: return "Separable";
+	case ConvolutionStrategy::Fft: return "FFT";
+	default: return "Unknown";
+	}
+}
+
+float rankOneApproximation(const ConvolutionKernel& kernel, std::vector<float>& column, std::vector<float>& row) {
+	validate(kernel);
+	const int w = kernel.width, h = kernel.height;
+
+	// Power iteration on K^T K for the leading right singular vector,
+	// started from the strongest row. A rank-1 kernel converges at once.
+	int strongest = 0;
+	double strongestNorm = -1.0;
+	for (int y = 0; y < h; ++y) {
+		double norm = 0.0;
+		for (int x = 0; x < w; ++x) norm += static_cast<double>(kernel.at(x, y)) * kernel.at(x, y);
+		if (norm > strongestNorm) {
+			strongestNorm = norm;
+			strongest = y;
+		}
+	}
+
+	std::vector<double> v(w), u(h), next(w);
+	for (int x = 0; x < w; ++x) v[x] = kernel.at(x, strongest);
+	auto normalize = [](std::vector<double>& vector) {
+		double norm = 0.0;
+		for (double value : vector) norm += value * value;
+		norm = std::sqrt(norm);
+		if (norm == 0.0) return false;
+		for (double& value : vector) value /= norm;
+		return true;
+	};
+	auto multiply = [&]() {
+		for (int y = 0; y < h; ++y) {
+			double sum = 0.0;
+			for (int x = 0; x < w; ++x) sum += kernel.at(x, y) * v[x];
+			u[y] = sum;
+		}
+	};
+
+	const bool nonzero = normalize(v);
+	for (int iteration = 0; nonzero && iteration < 500; ++iteration) {
+		multiply();
+		std::fill(next.begin(), next.end(), 0.0);
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) next[x] += kernel.at(x, y) * u[y];
+		}
+		if (!normalize(next)) break;
+		double change = 0.0;
+		for (int x = 0; x < w; ++x) change = std::max(change, std::abs(next[x] - v[x]));
+		v.swap(next);
+		if (change < 1e-12) break;
+	}
+	multiply();
+
+	// u = K v carries the singular value, v is unit length.
+	column.resize(h);
+	row.resize(w);
+	for (int y = 0; y < h; ++y) column[y] = static_cast<float>(u[y]);
+	for (int x = 0; x < w; ++x) row[x] = static_cast<float>(v[x]);
+
+	float error = 0.0f;
+	for (int y = 0; y < h; ++y) {
+		for (int x = 0; x < w; ++x) {
+			error = std::max(error, std::abs(column[y] * row[x] - kernel.at(x, y)));
+		}
+	}
+	return error;
+}
+
+bool separateKernel(const ConvolutionKernel& kernel, std::vector<float>& column, std::vector<float>& row, float tolerance) {
+	float largest = 0.0f;
+	for (float tap : kernel.taps) largest = std::max(largest, std::abs(tap));
+	return rankOneApproximation(kernel, column, row) <= tolerance * largest;
+}
+
+ConvolutionStrategy chooseConvolutionStrategy(const ConvolutionKernel& kernel, int width, int height) {
+	// Estimated multiply-adds per output sample of each strategy.
+	ConvolutionStrategy best = ConvolutionStrategy::Direct;
+	double bestCost = static_cast<double>(kernel.width) * kernel.height;
+
+	std::vector<float> column, row;
+	const double separableCost = kernel.width + kernel.height;
+	if (separableCost < bestCost && separateKernel(kernel, column, row)) {
+		best = ConvolutionStrategy::Separable;
+		bestCost = separableCost;
+	}
+
+	const int size = fftTileSize(kernel, width, height);
+	if (size > 0 && fftTileCost(kernel, size) < bestCost) {
+		best = ConvolutionStrategy::Fft;
+	}
+	return best;
+}
+
+ConvolutionStrategy convolve(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	const ConvolutionKernel& kernel, BorderMode border, ConvolutionOutput output, ConvolutionStrategy strategy) {
+	validate(kernel);
+	if (strategy == ConvolutionStrategy::Auto) strategy = chooseConvolutionStrategy(kernel, width, height);
+	if (width <= 0 || height <= 0) return strategy;
+	planes = std::min(planes, channels);
+
+	if (strategy == ConvolutionStrategy::Fft) {
+		const int size = fftTileSize(kernel, width, height);
+		if (size > 0) {
+			convolveFft(src, dst, width, height, channels, planes, kernel, size, border, output);
+			return strategy;
+		}
+		strategy = ConvolutionStrategy::Direct;
+	}
+
+	short weights[9];
+	if (strategy == ConvolutionStrategy::Direct && channels == 1 && planes == 1 && integerStencil(kernel, weights)) {
+		convolveStencil(src, dst, width, height, weights, kernel.offset, border, output);
+		return strategy;
+	}
+
+	// A forced separable run on a kernel that is not rank 1 uses its best
+	// rank-1 approximation.
+	const bool separable = strategy == ConvolutionStrategy::Separable;
+	std::vector<float> column, row;
+	if (separable) rankOneApproximation(kernel, column, row);
+	const int left = kernel.width / 2;
+	const int right = kernel.width - 1 - left;
+	const int above = kernel.height / 2;
+	const size_t stride = static_cast<size_t>(width) * channels;
+	const size_t paddedSize = static_cast<size_t>(width + left + right) * channels;
+	const int stripCount = (height + StripRows - 1) / StripRows;
+
+#pragma omp parallel
+	{
+		// Ring of the kernel.height source rows around the current output
+		// row: padded rows for the direct path, horizontally filtered rows
+		// for the separable one.
+		const size_t slotSize = separable ? stride : paddedSize;
+		std::vector<float> ring(slotSize * kernel.height);
+		std::vector<float> padded(separable ? paddedSize : 0);
+		std::vector<const float*> rows(kernel.height);
+		std::vector<const float*> sources(separable ? kernel.width : kernel.taps.size());
+		std::vector<float> response(stride);
+
+		auto slot = [&](int sy, int y0) {
+			return ring.data() + static_cast<size_t>((sy - (y0 - above)) % kernel.height) * slotSize;
+		};
+		auto load = [&](int sy, int y0) {
+			float* target = slot(sy, y0);
+			if (!separable) {
+				loadPaddedRow(src, width, height, channels, sy, left, right, border, target);
+				return;
+			}
+			loadPaddedRow(src, width, height, channels, sy, left, right, border, padded.data());
+			for (int k = 0; k < kernel.width; ++k) {
+				sources[k] = padded.data() + static_cast<size_t>(k) * channels;
+			}
+			weightedRowSum(sources.data(), row.data(), kernel.width, stride, target);
+		};
+
+#pragma omp for schedule(dynamic)
+		for (int strip = 0; strip < stripCount; ++strip) {
+			const int y0 = strip * StripRows;
+			const int y1 = std::min(height, y0 + StripRows);
+
+			for (int sy = y0 - above; sy < y0 - above + kernel.height - 1; ++sy) {
+				load(sy, y0);
+			}
+			for (int y = y0; y < y1; ++y) {
+				load(y - above + kernel.height - 1, y0);
+				for (int k = 0; k < kernel.height; ++k) {
+					rows[k] = slot(y - above + k, y0);
+				}
+				if (separable) {
+					weightedRowSum(rows.data(), column.data(), kernel.height, stride, response.data());
+				}
+				else {
+					for (int ky = 0; ky < kernel.height; ++ky) {
+						for (int kx = 0; kx < kernel.width; ++kx) {
+							sources[static_cast<size_t>(ky) * kernel.width + kx] = rows[ky] + static_cast<size_t>(kx) * channels;
+						}
+					}
+					weightedRowSum(sources.data(), kernel.taps.data(), static_cast<int>(kernel.taps.size()), stride, response.data());
+				}
+				storeRow(response.data(), src + y * stride, width, channels, planes, kernel.offset, output, dst + y * stride);
+			}
+		}
+	}
+
+	return strategy;
+}
+
+bool parseKernel(const std::string& text, ConvolutionKernel& kernel, std::string& error) {
+	std::vector<float> taps;
+	int width = 0, height = 0;
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line)) {
+		line = line.substr(0, line.find('#'));
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::replace(line.begin(), line.end(), ';', '\n');
+		std::istringstream rows(line);
+		std::string rowText;
+		while (std::getline(rows, rowText)) {
+			std::istringstream values(rowText);
+			std::string value;
+			int count = 0;
+			while (values >> value) {
+				char* end = nullptr;
+				const float tap = std::strtof(value.c_str(), &end);
+				if (end != value.c_str() + value.size()) {
+					error = "Invalid value '" + value + "' in row " + std::to_string(height + 1);
+					return false;
+				}
+				taps.push_back(tap);
+				++count;
+			}
+			if (count == 0) continue;
+			if (width != 0 && count != width) {
+				error = "Row " + std::to_string(height + 1) + " has " + std::to_string(count) + " values, expected " + std::to_string(width);
+				return false;
+			}
+			width = count;
+			++height;
+		}
+	}
+
+	if (height == 0) {
+		error = "The kernel is empty";
+		return false;
+	}
+	kernel.width = width;
+	kernel.height = height;
+	kernel.taps = std::move(taps);
+	error.clear();
+	return true;
+}
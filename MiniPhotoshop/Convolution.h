@@ -0,0 +1,92 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include "Stencil3x3.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Row-major taps anchored at (width / 2, height / 2). Tap (x, y) weights the
+// source pixel at offset (x - width / 2, y - height / 2) from the output
+// pixel, the orientation the filters have always used (correlation).
+struct ConvolutionKernel {
+    int width{0};
+    int height{0};
+    std::vector<float> taps;
+    // Added to every response before it is rounded, e.g. 128 for emboss.
+    float offset{0.0f};
+
+    float at(int x, int y) const { return taps[static_cast<size_t>(y) * width + x]; }
+
+    static ConvolutionKernel box(int size);
+    // Normalized size x size samples of a Gaussian.
+    static ConvolutionKernel gaussian(int size, float sigma);
+    // Normalized disk of the given radius with an antialiased rim, the
+    // aperture of a lens blur.
+    static ConvolutionKernel disk(int radius);
+};
+
+enum class ConvolutionStrategy {
+    Auto = 0,
+    Direct,
+    Separable,
+    Fft,
+    Count
+};
+
+const char* convolutionStrategyName(ConvolutionStrategy strategy);
+
+// How a response becomes an 8-bit value: rounded and saturated, or its
+// magnitude rounded and saturated (edge responses).
+enum class ConvolutionOutput {
+    Saturate = 0,
+    Absolute
+};
+
+// Best rank-1 approximation taps ~ column * row from the leading singular
+// vectors. Returns the largest absolute error over the taps.
+float rankOneApproximation(const ConvolutionKernel& kernel, std::vector<float>& column, std::vector<float>& row);
+
+// Splits a rank-1 kernel into taps = column * row, with every tap reproduced
+// within tolerance times the largest tap magnitude.
+bool separateKernel(const ConvolutionKernel& kernel, std::vector<float>& column, std::vector<float>& row, float tolerance = 1e-5f);
+
+// The strategy Auto resolves to, from estimated work per output sample:
+// width * height taps direct, width + height when the kernel has rank 1,
+// and the transform cost of the best overlap-save tile for the image size.
+ConvolutionStrategy chooseConvolutionStrategy(const ConvolutionKernel& kernel, int width, int height);
+
+// Normalized samples of a Gaussian centered on tap size / 2, the factor that
+// ConvolutionKernel::gaussian multiplies with itself.
+std::vector<float> gaussianTaps(int size, float sigma);
+
+// Row y of interleaved 8-bit pixels as floats, with the border rule applied on
+// both axes and padded by `left` and `right` pixels.
+void loadPaddedRow(const unsigned char* src, int width, int height, int channels, int y, int left, int right,
+    BorderMode border, float* out);
+
+// out[i] = sum of weights[t] * sources[t][i] over t < taps, in blocks the
+// compiler vectorizes. Every pass of convolve reduces to this.
+void weightedRowSum(const float* const* sources, const float* weights, int taps, size_t count, float* out);
+
+// Convolves the first `planes` channels of interleaved 8-bit pixels into
+// dst and copies the remaining channels. src and dst must not overlap.
+//
+// Auto picks the strategy with chooseConvolutionStrategy. Separable runs a
+// horizontal and a vertical pass, with the best rank-1 approximation if the
+// kernel is not separable. Fft multiplies spectra of overlap-save tiles
+// (kernels up to about 4000 taps per side, larger ones fall back to direct).
+// 3, 5 and 7 tap sides use loops unrolled at compile time,
+// other sizes a runtime loop, and single-plane 3x3 kernels with small
+// integer weights the dispatched int16 stencil. Row strips run in parallel.
+// Returns the strategy that was used; throws std::runtime_error on a
+// malformed kernel.
+ConvolutionStrategy convolve(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    const ConvolutionKernel& kernel, BorderMode border, ConvolutionOutput output = ConvolutionOutput::Saturate,
+    ConvolutionStrategy strategy = ConvolutionStrategy::Auto);
+
+// One kernel row per line (or separated by ';'), values separated by spaces
+// or commas, '#' starts a comment. On failure error describes the problem.
+bool parseKernel(const std::string& text, ConvolutionKernel& kernel, std::string& error);
+
+#endif // CONVOLUTION_H
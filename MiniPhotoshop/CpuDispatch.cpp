@@ -0,0 +1,185 @@
+#include "CpuDispatch.h"
+#include "SimdKernels.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#ifdef MINIPHOTOSHOP_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef MINIPHOTOSHOP_X86
+	void cpuid(int leaf, int subLeaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, leaf, subLeaf);
+		for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(info[i]);
+#else
+		__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	unsigned long long readXcr0() {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+	}
+#endif
+
+	SimdLevel queryCpu() {
+#ifdef MINIPHOTOSHOP_X86
+		unsigned int regs[4];
+		cpuid(0, 0, regs);
+		const unsigned int maxLeaf = regs[0];
+		if (maxLeaf < 1) return SimdLevel::Scalar;
+
+		cpuid(1, 0, regs);
+		const bool ssse3 = regs[2] & (1u << 9);
+		const bool sse41 = regs[2] & (1u << 19);
+		const bool osxsave = regs[2] & (1u << 27);
+		const bool avx = regs[2] & (1u << 28);
+		if (!ssse3 || !sse41) return SimdLevel::Scalar;
+		if (!osxsave || !avx || maxLeaf < 7) return SimdLevel::Sse41;
+
+		// The OS has to save the wider register files on context switches,
+		// otherwise the instructions exist but must not be used.
+		const unsigned long long xcr0 = readXcr0();
+		const bool ymmState = (xcr0 & 0x6) == 0x6;
+		const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+		cpuid(7, 0, regs);
+		const bool avx2 = regs[1] & (1u << 5);
+		const bool avx512f = regs[1] & (1u << 16);
+		const bool avx512bw = regs[1] & (1u << 30);
+		if (!ymmState || !avx2) return SimdLevel::Sse41;
+		if (!zmmState || !avx512f || !avx512bw) return SimdLevel::Avx2;
+		return SimdLevel::Avx512bw;
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+
+	std::string readEnvironment(const char* name) {
+#if defined(_MSC_VER)
+		char* value = nullptr;
+		size_t length = 0;
+		if (_dupenv_s(&value, &length, name) != 0 || !value) return {};
+		std::string result(value);
+		std::free(value);
+		return result;
+#else
+		const char* value = std::getenv(name);
+		return value ? value : "";
+#endif
+	}
+
+	bool parseLevel(std::string name, SimdLevel& level) {
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (name == "scalar") level = SimdLevel::Scalar;
+		else if (name == "sse4.1" || name == "sse41") level = SimdLevel::Sse41;
+		else if (name == "avx2") level = SimdLevel::Avx2;
+		else if (name == "avx512" || name == "avx512bw") level = SimdLevel::Avx512bw;
+		else return false;
+		return true;
+	}
+
+	KernelTable buildTable(SimdLevel level) {
+		KernelTable table{};
+		simd::installScalar(table);
+#ifdef MINIPHOTOSHOP_X86
+		if (level >= SimdLevel::Sse41) simd::installSse41(table);
+		if (level >= SimdLevel::Avx2) simd::installAvx2(table);
+		if (level >= SimdLevel::Avx512bw) simd::installAvx512bw(table);
+#endif
+		return table;
+	}
+
+	// Every supported level gets its own table, built once and never changed
+	// afterwards. Switching only swaps the pointer, so a worker thread that
+	// still runs kernels of the previous table reads consistent entries.
+	struct DispatchState {
+		SimdLevel detected;
+		std::array<KernelTable, static_cast<size_t>(SimdLevel::Count)> tables{};
+		std::atomic<const KernelTable*> table{ nullptr };
+		std::atomic<SimdLevel> active{ SimdLevel::Scalar };
+
+		DispatchState() {
+			detected = queryCpu();
+			SimdLevel selected = detected;
+
+			const std::string forced = readEnvironment("MINIPHOTOSHOP_SIMD");
+			if (!forced.empty()) {
+				SimdLevel requested;
+				if (!parseLevel(forced, requested)) {
+					std::cout << "Unknown MINIPHOTOSHOP_SIMD value: " << forced << std::endl;
+				}
+				else if (requested > detected) {
+					std::cout << "MINIPHOTOSHOP_SIMD=" << forced << " is not supported by this CPU" << std::endl;
+				}
+				else {
+					selected = requested;
+				}
+			}
+
+			for (int level = 0; level <= static_cast<int>(detected); ++level) {
+				tables[level] = buildTable(static_cast<SimdLevel>(level));
+			}
+			table = &tables[static_cast<size_t>(selected)];
+			active = selected;
+			std::cout << "CPU dispatch: detected " << simdLevelName(detected)
+				<< ", using " << simdLevelName(selected) << " kernels" << std::endl;
+		}
+	};
+
+	DispatchState& state() {
+		static DispatchState instance;
+		return instance;
+	}
+
+}
+
+const char* simdLevelName(SimdLevel level) {
+	switch (level) {
+	case SimdLevel::Scalar: return "Scalar";
+	case SimdLevel::Sse41: return "SSE4.1";
+	case SimdLevel::Avx2: return "AVX2";
+	case SimdLevel::Avx512bw: return "AVX-512BW";
+	default: return "Unknown";
+	}
+}
+
+SimdLevel detectedSimdLevel() {
+	return state().detected;
+}
+
+SimdLevel activeSimdLevel() {
+	return state().active;
+}
+
+SimdLevel setSimdLevel(SimdLevel level) {
+	DispatchState& s = state();
+	const SimdLevel clamped = std::min(level, s.detected);
+	if (s.active.exchange(clamped) != clamped) {
+		s.table = &s.tables[static_cast<size_t>(clamped)];
+		std::cout << "CPU dispatch: switched to " << simdLevelName(clamped) << " kernels" << std::endl;
+	}
+	return s.active;
+}
+
+const KernelTable& kernels() {
+	return *state().table.load();
+}
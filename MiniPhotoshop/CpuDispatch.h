@@ -0,0 +1,71 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MINIPHOTOSHOP_X86 1
+#endif
+
+enum class SimdLevel {
+    Scalar = 0,
+    Sse41,
+    Avx2,
+    Avx512bw,
+    Count
+};
+
+// Pixel kernels that are compiled once per instruction set. Every variant
+// produces bit-identical results, so switching paths only changes speed.
+struct KernelTable {
+    // Interleaved RGB(A) -> 8-bit luma plane, (77 R + 150 G + 29 B + 128) >> 8.
+    void (*rgbToLuma)(const unsigned char* src, unsigned char* dst, size_t pixelCount, unsigned int channels);
+    // 255 - value on the color channels, alpha is left untouched.
+    void (*invertColor)(unsigned char* data, size_t pixelCount, unsigned int channels);
+    // Interior of a 3x3 stencil row: dst[i] = sum of weights[r * 3 + c] * rows[r][i + c - 1].
+    // The caller guarantees rows[r][-1] and rows[r][count] are readable.
+    void (*stencil3x3Row)(const unsigned char* const rows[3], const short weights[9], short* dst, size_t count);
+    // Fused Sobel (center = 2) or Prewitt (center = 1) pair over the same rows.
+    void (*gradient3x3Row)(const unsigned char* const rows[3], int center, short* gx, short* gy, size_t count);
+    // sqrt(gx^2 + gy^2), exact in every variant.
+    void (*gradientMagnitude)(const short* gx, const short* gy, float* magnitude, size_t count);
+    // Sets the luma of every pixel to luma[i] and keeps Cb and Cr, which in
+    // YCbCr means adding luma[i] - Y to R, G and B (saturated). Alpha is kept.
+    void (*replaceLuma)(unsigned char* data, const unsigned char* luma, size_t pixelCount, unsigned int channels);
+    // Median of the size x size window (size 3 or 5) centered on rows[size / 2][i].
+    // The caller guarantees rows[r][-size / 2] and rows[r][count - 1 + size / 2] are readable.
+    void (*medianRow)(const unsigned char* const* rows, int size, unsigned char* dst, size_t count);
+    // One explicit Perona-Malik step of a float row: row[i] plus lambda times
+    // the conducted differences to its four neighbours, see conductionOf in
+    // SimdScalar.h for the conduction index. The caller guarantees row[-1]
+    // and row[count] are readable.
+    void (*diffusionRow)(const float* above, const float* row, const float* below, float* dst, size_t count,
+        int conduction, float inverseKappaSquared, float lambda);
+    // Horizontal resampling of one interleaved row: channel c of output pixel
+    // x is the sum over t < taps of weights[x * taps + t] times channel c of
+    // src[starts[x] + t], in units of 2^-14, rounded and saturated. The caller
+    // guarantees starts[x] + taps <= srcWidth.
+    void (*resampleRow)(const unsigned char* src, size_t srcWidth, const int* starts, const short* weights, int taps,
+        unsigned char* dst, size_t dstWidth, unsigned int channels);
+    // Vertical resampling: dst[i] is the sum of weights[t] * rows[t][i] over
+    // t < taps, rounded and saturated like resampleRow.
+    void (*resampleColumns)(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, size_t count);
+};
+
+const char* simdLevelName(SimdLevel level);
+
+// Highest level supported by both the CPU and the operating system.
+SimdLevel detectedSimdLevel();
+SimdLevel activeSimdLevel();
+
+// Forces a kernel variant. Levels above the detected one are clamped, so a
+// forced path can never execute unsupported instructions. Returns the level
+// that is actually active afterwards. Safe while other threads run kernels:
+// they finish on the table they already hold, which stays valid.
+SimdLevel setSimdLevel(SimdLevel level);
+
+// Selects the variant on first use. The MINIPHOTOSHOP_SIMD environment
+// variable (scalar, sse4.1, avx2, avx512) overrides the cpuid result.
+const KernelTable& kernels();
+
+#endif // CPU_DISPATCH_H
@@ -0,0 +1,161 @@
+#include "Fft.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+	typedef std::complex<float> Complex;
+
+	const double Pi = 3.14159265358979323846;
+
+	bool isPowerOfTwo(size_t n) {
+		return n != 0 && (n & (n - 1)) == 0;
+	}
+
+	Complex twiddle(size_t k, size_t n) {
+		const double angle = -2.0 * Pi * static_cast<double>(k) / static_cast<double>(n);
+		return Complex(static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)));
+	}
+
+	// Multiplication by -i.
+	Complex rotate(Complex c) {
+		return Complex(c.imag(), -c.real());
+	}
+
+	template <typename Plan>
+	const Plan& cachedPlan(size_t size) {
+		static std::mutex mutex;
+		static std::map<size_t, std::unique_ptr<Plan>> plans;
+		std::lock_guard<std::mutex> lock(mutex);
+		std::unique_ptr<Plan>& plan = plans[size];
+		if (!plan) plan.reset(new Plan(size));
+		return *plan;
+	}
+
+}
+
+FftPlan::FftPlan(size_t size) : n(size), twiddles(size / 2), bitReverse(size) {
+	if (!isPowerOfTwo(size)) {
+		throw std::runtime_error("FFT size must be a power of two: " + std::to_string(size));
+	}
+	for (size_t k = 0; k < n / 2; ++k) {
+		twiddles[k] = twiddle(k, n);
+	}
+
+	int bits = 0;
+	while ((static_cast<size_t>(1) << bits) < n) ++bits;
+	for (size_t i = 0; i < n; ++i) {
+		size_t reversed = 0;
+		for (int b = 0; b < bits; ++b) {
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		bitReverse[i] = static_cast<unsigned int>(reversed);
+	}
+}
+
+void FftPlan::forward(Complex* data) const {
+	for (size_t i = 0; i < n; ++i) {
+		const size_t j = bitReverse[i];
+		if (i < j) std::swap(data[i], data[j]);
+	}
+
+	size_t length = 1;
+	int levels = 0;
+	while ((static_cast<size_t>(1) << levels) < n) ++levels;
+	if (levels % 2 == 1) {
+		for (size_t i = 0; i < n; i += 2) {
+			const Complex a = data[i], b = data[i + 1];
+			data[i] = a + b;
+			data[i + 1] = a - b;
+		}
+		length = 2;
+	}
+
+	// Four sub-transforms of `length` points become one of 4 * length: the
+	// first radix-2 level pairs (0, 1) and (2, 3) with W(2 * length), the
+	// second pairs the results with W(4 * length).
+	for (; length < n; length *= 4) {
+		const size_t innerStride = n / (2 * length);
+		const size_t outerStride = n / (4 * length);
+		for (size_t block = 0; block < n; block += 4 * length) {
+			Complex* p = data + block;
+			for (size_t j = 0; j < length; ++j) {
+				const Complex w2 = twiddles[j * innerStride];
+				const Complex w4 = twiddles[j * outerStride];
+				const Complex a1 = w2 * p[j + length];
+				const Complex a3 = w2 * p[j + 3 * length];
+				const Complex t0 = p[j] + a1, t1 = p[j] - a1;
+				const Complex t2 = p[j + 2 * length] + a3, t3 = p[j + 2 * length] - a3;
+				const Complex b2 = w4 * t2;
+				const Complex b3 = rotate(w4 * t3);
+				p[j] = t0 + b2;
+				p[j + 2 * length] = t0 - b2;
+				p[j + length] = t1 + b3;
+				p[j + 3 * length] = t1 - b3;
+			}
+		}
+	}
+}
+
+void FftPlan::inverse(Complex* data) const {
+	// conj(FFT(conj(x))) is the unnormalized inverse.
+	for (size_t i = 0; i < n; ++i) data[i] = std::conj(data[i]);
+	forward(data);
+	for (size_t i = 0; i < n; ++i) data[i] = std::conj(data[i]);
+}
+
+RealFftPlan::RealFftPlan(size_t size) : n(size), half(fftPlan(size / 2)), twiddles(size / 2 + 1) {
+	if (size < 2) {
+		throw std::runtime_error("Real FFT size must be at least 2");
+	}
+	for (size_t k = 0; k <= n / 2; ++k) {
+		twiddles[k] = twiddle(k, n);
+	}
+}
+
+void RealFftPlan::forward(const float* in, Complex* out, Complex* scratch) const {
+	const size_t m = n / 2;
+	// Even samples in the real parts, odd samples in the imaginary parts.
+	for (size_t k = 0; k < m; ++k) {
+		scratch[k] = Complex(in[2 * k], in[2 * k + 1]);
+	}
+	half.forward(scratch);
+
+	// Split into the transforms of the even and odd samples and recombine:
+	// X[k] = E[k] + W(n)^k O[k].
+	for (size_t k = 0; k <= m; ++k) {
+		const Complex z = scratch[k % m];
+		const Complex mirror = std::conj(scratch[(m - k) % m]);
+		const Complex even = 0.5f * (z + mirror);
+		const Complex odd = Complex(0.0f, -0.5f) * (z - mirror);
+		out[k] = even + twiddles[k] * odd;
+	}
+}
+
+void RealFftPlan::inverse(const Complex* in, float* out, Complex* scratch) const {
+	const size_t m = n / 2;
+	for (size_t k = 0; k < m; ++k) {
+		const Complex x = in[k];
+		const Complex mirror = std::conj(in[m - k]);
+		const Complex even = x + mirror;
+		const Complex odd = (x - mirror) * std::conj(twiddles[k]);
+		scratch[k] = even + Complex(0.0f, 1.0f) * odd;
+	}
+	half.inverse(scratch);
+	for (size_t k = 0; k < m; ++k) {
+		out[2 * k] = scratch[k].real();
+		out[2 * k + 1] = scratch[k].imag();
+	}
+}
+
+const FftPlan& fftPlan(size_t size) {
+	return cachedPlan<FftPlan>(size);
+}
+
+const RealFftPlan& realFftPlan(size_t size) {
+	return cachedPlan<RealFftPlan>(size);
+}
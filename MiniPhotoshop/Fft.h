@@ -0,0 +1,52 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// In-place complex FFT for power-of-two sizes. Bit-reversed input is
+// combined two radix-2 levels per pass (radix-2^2, i.e. radix-4 butterflies),
+// with one radix-2 pass first when log2(size) is odd.
+class FftPlan {
+public:
+    explicit FftPlan(size_t size);
+
+    size_t size() const { return n; }
+    void forward(std::complex<float>* data) const;
+    // Unnormalized: forward followed by inverse scales by size().
+    void inverse(std::complex<float>* data) const;
+
+private:
+    size_t n;
+    // exp(-2 pi i k / n) for k < n / 2, computed in double.
+    std::vector<std::complex<float>> twiddles;
+    std::vector<unsigned int> bitReverse;
+};
+
+// Real-input FFT of an even power-of-two size through a complex FFT of half
+// the size. The spectrum holds the size / 2 + 1 non-redundant bins.
+class RealFftPlan {
+public:
+    explicit RealFftPlan(size_t size);
+
+    size_t size() const { return n; }
+    size_t bins() const { return n / 2 + 1; }
+    // `scratch` holds size() / 2 complex values.
+    void forward(const float* in, std::complex<float>* out, std::complex<float>* scratch) const;
+    // Unnormalized like FftPlan::inverse. `in` is not modified.
+    void inverse(const std::complex<float>* in, float* out, std::complex<float>* scratch) const;
+
+private:
+    size_t n;
+    const FftPlan& half;
+    // exp(-2 pi i k / n) for k <= n / 2.
+    std::vector<std::complex<float>> twiddles;
+};
+
+// Plans are built once per size and shared by every caller and thread; the
+// references stay valid for the lifetime of the program.
+const FftPlan& fftPlan(size_t size);
+const RealFftPlan& realFftPlan(size_t size);
+
+#endif // FFT_H
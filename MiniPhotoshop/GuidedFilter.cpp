@@ -0,0 +1,195 @@
+#include "GuidedFilter.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+	const int MaxPlanes = 4;
+
+	// Running window state of one row strip. Column sums of the first box
+	// are exact integers: guide, guide^2, then p and guide * p per plane.
+	// Those of the second box (a, then b per plane) are doubles.
+	class GuidedStrip {
+	public:
+		GuidedStrip(const unsigned char* src, int width, int height, int channels, int firstPlane, int planes,
+			const unsigned char* guide, int radius, double epsilon)
+			: src(src), width(width), height(height), channels(channels), firstPlane(firstPlane), planes(planes),
+			guide(guide), radius(radius), epsilon(epsilon), moments(2 + 2 * planes), coefficients(2 * planes),
+			ringRows(2 * radius + 1),
+			momentColumns(static_cast<size_t>(width) * moments),
+			coefficientColumns(static_cast<size_t>(width) * coefficients),
+			ring(static_cast<size_t>(ringRows) * width * coefficients),
+			row(static_cast<size_t>(width) * coefficients) {
+		}
+
+		void run(unsigned char* dst, int y0, int y1, float detail) {
+			std::fill(momentColumns.begin(), momentColumns.end(), 0);
+			std::fill(coefficientColumns.begin(), coefficientColumns.end(), 0.0);
+			const int first = std::max(0, y0 - radius);
+			const int last = std::min(height, y1 + radius);
+			int low = std::max(0, first - radius);
+			int high = low;
+			lowest = first;
+
+			int next = y0;
+			for (int j = first; j < last; ++j) {
+				for (; high < std::min(height, j + radius + 1); ++high) accumulateMoments(high, 1);
+				for (; low < std::max(0, j - radius); ++low) accumulateMoments(low, -1);
+				solveRow(high - low);
+
+				dropBelow(j - 2 * radius);
+				float* slot = ring.data() + static_cast<size_t>(j % ringRows) * width * coefficients;
+				std::copy(row.begin(), row.end(), slot);
+				accumulateCoefficients(slot, 1.0);
+
+				for (; next < y1 && std::min(height - 1, next + radius) <= j; ++next) {
+					dropBelow(next - radius);
+					emitRow(dst, next, j - lowest + 1, detail);
+				}
+			}
+		}
+
+	private:
+		void accumulateMoments(int y, int sign) {
+			const unsigned char* pixels = src + static_cast<size_t>(y) * width * channels + firstPlane;
+			const unsigned char* levels = guide + static_cast<size_t>(y) * width;
+			int* sums = momentColumns.data();
+			for (int x = 0; x < width; ++x, sums += moments) {
+				const int g = levels[x] * sign;
+				sums[0] += g;
+				sums[1] += g * levels[x];
+				for (int k = 0; k < planes; ++k) {
+					const int p = pixels[static_cast<size_t>(x) * channels + k];
+					sums[2 + k] += p * sign;
+					sums[2 + planes + k] += g * p;
+				}
+			}
+		}
+
+		void accumulateCoefficients(const float* values, double sign) {
+			double* sums = coefficientColumns.data();
+			const size_t count = static_cast<size_t>(width) * coefficients;
+			for (size_t i = 0; i < count; ++i) sums[i] += sign * values[i];
+		}
+
+		// Drops coefficient rows below `bound` from the second box.
+		void dropBelow(int bound) {
+			for (; lowest < bound; ++lowest) {
+				accumulateCoefficients(ring.data() + static_cast<size_t>(lowest % ringRows) * width * coefficients, -1.0);
+			}
+		}
+
+		// a and b of every plane for the current first-box window into `row`.
+		void solveRow(int rows) {
+			long long window[2 + 2 * MaxPlanes] = {};
+			addColumns(momentColumns.data(), moments, 0, std::min(radius, width - 1), window);
+			for (int x = 0; x < width; ++x) {
+				if (x > 0) slide(momentColumns.data(), moments, x, window);
+				const double n = static_cast<double>(columnsAround(x)) * rows;
+				const double meanGuide = window[0] / n;
+				const double variance = window[1] / n - meanGuide * meanGuide;
+				float* out = row.data() + static_cast<size_t>(x) * coefficients;
+				for (int k = 0; k < planes; ++k) {
+					const double meanP = window[2 + k] / n;
+					const double covariance = window[2 + planes + k] / n - meanGuide * meanP;
+					const double a = covariance / (variance + epsilon);
+					out[k] = static_cast<float>(a);
+					out[planes + k] = static_cast<float>(meanP - a * meanGuide);
+				}
+			}
+		}
+
+		void emitRow(unsigned char* dst, int y, int rows, float detail) {
+			const unsigned char* pixels = src + static_cast<size_t>(y) * width * channels;
+			unsigned char* out = dst + static_cast<size_t>(y) * width * channels;
+			const unsigned char* levels = guide + static_cast<size_t>(y) * width;
+			double window[2 * MaxPlanes] = {};
+			addColumns(coefficientColumns.data(), coefficients, 0, std::min(radius, width - 1), window);
+			for (int x = 0; x < width; ++x) {
+				if (x > 0) slide(coefficientColumns.data(), coefficients, x, window);
+				const double n = static_cast<double>(columnsAround(x)) * rows;
+				for (int k = 0; k < planes; ++k) {
+					const size_t i = static_cast<size_t>(x) * channels + firstPlane + k;
+					const double q = (window[k] * levels[x] + window[planes + k]) / n;
+					const double value = q + detail * (pixels[i] - q);
+					out[i] = static_cast<unsigned char>(std::min(std::max(value + 0.5, 0.0), 255.0));
+				}
+			}
+		}
+
+		int columnsAround(int x) const {
+			return std::min(x + radius, width - 1) - std::max(x - radius, 0) + 1;
+		}
+
+		template <typename Column, typename Sum>
+		void addColumns(const Column* columns, int stride, int begin, int end, Sum* window) const {
+			for (int x = begin; x <= end; ++x) {
+				for (int i = 0; i < stride; ++i) window[i] += columns[static_cast<size_t>(x) * stride + i];
+			}
+		}
+
+		// Moves a row window from x - 1 to x.
+		template <typename Column, typename Sum>
+		void slide(const Column* columns, int stride, int x, Sum* window) const {
+			if (x + radius < width) {
+				const Column* entering = columns + static_cast<size_t>(x + radius) * stride;
+				for (int i = 0; i < stride; ++i) window[i] += entering[i];
+			}
+			if (x - radius - 1 >= 0) {
+				const Column* leaving = columns + static_cast<size_t>(x - radius - 1) * stride;
+				for (int i = 0; i < stride; ++i) window[i] -= leaving[i];
+			}
+		}
+
+		const unsigned char* src;
+		int width;
+		int height;
+		int channels;
+		int firstPlane;
+		int planes;
+		const unsigned char* guide;
+		int radius;
+		double epsilon;
+		int moments;
+		int coefficients;
+		int ringRows;
+		int lowest{ 0 };
+		std::vector<int> momentColumns;
+		std::vector<double> coefficientColumns;
+		std::vector<float> ring;
+		std::vector<float> row;
+	};
+
+}
+
+void guidedFilter(const unsigned char* src, unsigned char* dst, int width, int height, int channels,
+	int firstPlane, int planes, const unsigned char* guide, int radius, float epsilon, float detail) {
+	if (width <= 0 || height <= 0) return;
+	firstPlane = std::min(std::max(firstPlane, 0), channels);
+	planes = std::min(std::min(planes, channels - firstPlane), MaxPlanes);
+	radius = std::max(radius, 0);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	for (int c = 0; c < channels; ++c) {
+		if (c >= firstPlane && c < firstPlane + planes) continue;
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = src[i * channels + c];
+	}
+	if (planes <= 0) return;
+
+	// Every strip first runs 2 radius rows ahead, so strips grow with the
+	// radius to keep that overhead small.
+	const int stripRows = std::max(StripRows, 8 * radius);
+	const int strips = (height + stripRows - 1) / stripRows;
+	const double scaledEpsilon = static_cast<double>(epsilon) * epsilon * 255.0 * 255.0;
+
+#pragma omp parallel
+	{
+		GuidedStrip strip(src, width, height, channels, firstPlane, planes, guide, radius, scaledEpsilon);
+
+#pragma omp for schedule(dynamic)
+		for (int s = 0; s < strips; ++s) {
+			const int y0 = s * stripRows;
+			strip.run(dst, y0, std::min(y0 + stripRows, height), detail);
+		}
+	}
+}
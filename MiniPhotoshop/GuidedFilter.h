@@ -0,0 +1,23 @@
+#ifndef GUIDED_FILTER_H
+#define GUIDED_FILTER_H
+
+// Guided filter (He et al.) with a grayscale guide. Per window the output is
+// the linear model a * guide + b that best fits the input; a and b are then
+// averaged over the windows of each pixel:
+//   a = cov(guide, p) / (var(guide) + epsilon^2),  b = mean(p) - a * mean(guide)
+// with epsilon relative to the 0..1 range. Windows are (2 radius + 1)^2 boxes
+// clipped to the image.
+//
+// Channels [firstPlane, firstPlane + planes) of src are filtered with the
+// same guide plane and written as q + detail * (p - q), so detail = 0
+// smooths, 1 keeps the input and larger values enhance detail. The other
+// channels are copied.
+//
+// All box means come from one streaming pass of running column and row
+// sums over row strips, for guide, guide^2, p and guide * p of every plane
+// at once; a and b are kept only for the 2 radius + 1 rows the second box
+// needs. Linear in the pixel count, independent of the radius.
+void guidedFilter(const unsigned char* src, unsigned char* dst, int width, int height, int channels,
+    int firstPlane, int planes, const unsigned char* guide, int radius, float epsilon, float detail);
+
+#endif // GUIDED_FILTER_H
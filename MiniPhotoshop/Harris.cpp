@@ -0,0 +1,158 @@
+#include "Harris.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+	const int StripRows = 64;
+
+	// Weights sum to 9, the pixel count of the 3x3 box the tensor used to be
+	// summed over, so responses and thresholds keep the scale of box sums.
+	const float WindowArea = 9.0f;
+
+	std::vector<float> gaussianWeights(float sigma, int& radius) {
+		sigma = std::max(sigma, 0.1f);
+		radius = std::max(1, static_cast<int>(std::ceil(3.0f * sigma)));
+		std::vector<float> weights(2 * radius + 1);
+		float sum = 0.0f;
+		for (int k = -radius; k <= radius; ++k) {
+			weights[k + radius] = std::exp(-(k * k) / (2.0f * sigma * sigma));
+			sum += weights[k + radius];
+		}
+		for (float& weight : weights) {
+			weight *= std::sqrt(WindowArea) / sum;
+		}
+		return weights;
+	}
+
+	struct TensorRows {
+		std::vector<float> xx;
+		std::vector<float> yy;
+		std::vector<float> xy;
+	};
+
+	// Harris response of row y. The Gaussian window is applied separably:
+	// the vertical pass accumulates the three tensor products per column,
+	// the horizontal pass weights those column sums.
+	void responseRow(const short* gx, const short* gy, int width, int height, int y, const std::vector<float>& weights, int radius,
+		BorderMode border, float k, TensorRows& columns, float* response) {
+		std::fill(columns.xx.begin(), columns.xx.end(), 0.0f);
+		std::fill(columns.yy.begin(), columns.yy.end(), 0.0f);
+		std::fill(columns.xy.begin(), columns.xy.end(), 0.0f);
+		float* xx = columns.xx.data();
+		float* yy = columns.yy.data();
+		float* xy = columns.xy.data();
+
+		for (int t = -radius; t <= radius; ++t) {
+			const int sy = borderCoordinate(y + t, height, border);
+			if (sy < 0) continue;
+			const short* rowX = gx + static_cast<size_t>(sy) * width;
+			const short* rowY = gy + static_cast<size_t>(sy) * width;
+			const float weight = weights[t + radius];
+			for (int x = 0; x < width; ++x) {
+				const float dx = rowX[x], dy = rowY[x];
+				xx[x] += weight * dx * dx;
+				yy[x] += weight * dy * dy;
+				xy[x] += weight * dx * dy;
+			}
+		}
+
+		auto store = [&](int x, float sxx, float syy, float sxy) {
+			const float det = sxx * syy - sxy * sxy;
+			const float trace = sxx + syy;
+			response[x] = det - k * trace * trace;
+		};
+		auto borderPixel = [&](int x) {
+			float sxx = 0.0f, syy = 0.0f, sxy = 0.0f;
+			for (int t = -radius; t <= radius; ++t) {
+				const int sx = borderCoordinate(x + t, width, border);
+				if (sx < 0) continue;
+				const float weight = weights[t + radius];
+				sxx += weight * xx[sx];
+				syy += weight * yy[sx];
+				sxy += weight * xy[sx];
+			}
+			store(x, sxx, syy, sxy);
+		};
+
+		const int interiorBegin = std::min(radius, width);
+		const int interiorEnd = std::max(interiorBegin, width - radius);
+		for (int x = 0; x < interiorBegin; ++x) borderPixel(x);
+		for (int x = interiorBegin; x < interiorEnd; ++x) {
+			float sxx = 0.0f, syy = 0.0f, sxy = 0.0f;
+			for (int t = 0; t <= 2 * radius; ++t) {
+				const int sx = x + t - radius;
+				sxx += weights[t] * xx[sx];
+				syy += weights[t] * yy[sx];
+				sxy += weights[t] * xy[sx];
+			}
+			store(x, sxx, syy, sxy);
+		}
+		for (int x = interiorEnd; x < width; ++x) borderPixel(x);
+	}
+
+}
+
+std::vector<Keypoint> harrisCorners(const short* gx, const short* gy, int width, int height, const HarrisParameters& params, BorderMode border) {
+	if (width <= 0 || height <= 0) return {};
+
+	int radius = 0;
+	const std::vector<float> weights = gaussianWeights(params.windowSigma, radius);
+	const int stripCount = (height + StripRows - 1) / StripRows;
+	std::vector<std::vector<Keypoint>> stripCorners(stripCount);
+
+#pragma omp parallel
+	{
+		// Response rows y0 - 1 .. y1 of the current strip; the extra rows
+		// are the suppression halo and are recomputed by both neighbours.
+		TensorRows columns{ std::vector<float>(width), std::vector<float>(width), std::vector<float>(width) };
+		std::vector<float> response(static_cast<size_t>(StripRows + 2) * width);
+
+#pragma omp for schedule(dynamic)
+		for (int strip = 0; strip < stripCount; ++strip) {
+			const int y0 = strip * StripRows;
+			const int y1 = std::min(height, y0 + StripRows);
+			const int r0 = std::max(y0 - 1, 0);
+			const int r1 = std::min(y1 + 1, height);
+			auto rowAt = [&](int y) { return response.data() + static_cast<size_t>(y - (y0 - 1)) * width; };
+
+			for (int y = r0; y < r1; ++y) {
+				responseRow(gx, gy, width, height, y, weights, radius, border, params.k, columns, rowAt(y));
+			}
+
+			std::vector<Keypoint>& corners = stripCorners[strip];
+			for (int y = y0; y < y1; ++y) {
+				const float* row = rowAt(y);
+				for (int x = 0; x < width; ++x) {
+					const float value = row[x];
+					if (value <= params.threshold) continue;
+
+					bool isMax = true;
+					for (int wy = std::max(y - 1, 0); wy <= std::min(y + 1, height - 1) && isMax; ++wy) {
+						const float* neighbours = rowAt(wy);
+						for (int wx = std::max(x - 1, 0); wx <= std::min(x + 1, width - 1); ++wx) {
+							if ((wx != x || wy != y) && neighbours[wx] >= value) {
+								isMax = false;
+								break;
+							}
+						}
+					}
+					if (isMax) {
+						corners.push_back({ static_cast<float>(x), static_cast<float>(y), value, params.windowSigma });
+					}
+				}
+			}
+		}
+	}
+
+	size_t total = 0;
+	for (const std::vector<Keypoint>& corners : stripCorners) {
+		total += corners.size();
+	}
+	std::vector<Keypoint> result;
+	result.reserve(total);
+	for (const std::vector<Keypoint>& corners : stripCorners) {
+		result.insert(result.end(), corners.begin(), corners.end());
+	}
+	return result;
+}
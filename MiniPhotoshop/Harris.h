@@ -0,0 +1,24 @@
+#ifndef HARRIS_H
+#define HARRIS_H
+
+#include <vector>
+
+#include "Keypoint.h"
+#include "Stencil3x3.h"
+
+struct HarrisParameters {
+    float k{ 0.04f };
+    // Minimum det - k * trace^2 for a local maximum to be reported. The
+    // window weights sum to 9 like the 3x3 box sum of the first version, so
+    // uniform gradients give the same response as they did there.
+    float threshold{ 0.0f };
+    // Sigma of the Gaussian window the structure tensor is summed over.
+    float windowSigma{ 1.0f };
+};
+
+// Harris corners from Sobel derivatives. The response is produced and
+// suppressed strip by strip, so no full-size response plane is allocated.
+// Corners are returned in row-major order.
+std::vector<Keypoint> harrisCorners(const short* gx, const short* gy, int width, int height, const HarrisParameters& params, BorderMode border);
+
+#endif // HARRIS_H
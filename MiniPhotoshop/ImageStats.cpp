@@ -0,0 +1,208 @@
+#include "ImageStats.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	// Cheap integer hash for the sample position inside a grid cell.
+	unsigned int hashCell(unsigned int x, unsigned int y) {
+		unsigned int h = x * 0x9E3779B1u ^ (y + 0x7F4A7C15u) * 0x85EBCA77u;
+		h ^= h >> 15;
+		h *= 0x2C1B3C6Du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	ChannelStats summarize(const std::array<int, 256>& histogram, long long pixelCount) {
+		ChannelStats stats;
+		if (pixelCount == 0) return stats;
+
+		stats.min = static_cast<int>(std::find_if(histogram.begin(), histogram.end(), [](int n) { return n > 0; }) - histogram.begin());
+		stats.max = 255 - static_cast<int>(std::find_if(histogram.rbegin(), histogram.rend(), [](int n) { return n > 0; }) - histogram.rbegin());
+
+		double sum = 0.0, squares = 0.0;
+		for (int v = 0; v < 256; ++v) {
+			sum += static_cast<double>(histogram[v]) * v;
+			squares += static_cast<double>(histogram[v]) * v * v;
+		}
+		stats.mean = sum / pixelCount;
+		stats.stddev = std::sqrt(std::max(0.0, squares / pixelCount - stats.mean * stats.mean));
+		stats.shadowClipped = histogram[0];
+		stats.highlightClipped = histogram[255];
+		return stats;
+	}
+
+}
+
+const std::array<int, 256>& ImageStats::histogram(StatsChannel channel) const {
+	return histograms[static_cast<size_t>(channel)];
+}
+
+const ChannelStats& ImageStats::channel(StatsChannel channel) const {
+	return channels[static_cast<size_t>(channel)];
+}
+
+int ImageStats::percentile(StatsChannel channel, double fraction) const {
+	const std::array<int, 256>& bins = histogram(channel);
+	const long long target = std::max(1LL, static_cast<long long>(std::ceil(fraction * pixelCount)));
+	long long cumulative = 0;
+	for (int v = 0; v < 256; ++v) {
+		cumulative += bins[v];
+		if (cumulative >= target) return v;
+	}
+	return 255;
+}
+
+ImageStats computeImageStats(const unsigned char* data, int width, int height, int channels, const std::atomic<bool>* cancel) {
+	ImageStats stats;
+	stats.pixelCount = static_cast<long long>(width) * height;
+	if (!data || stats.pixelCount == 0) return stats;
+
+	const size_t histogramCount = static_cast<size_t>(StatsChannel::Count);
+
+#pragma omp parallel
+	{
+		std::array<std::array<int, 256>, static_cast<size_t>(StatsChannel::Count)> local{};
+		long long shadows = 0, highlights = 0;
+		std::vector<unsigned char> lumaRow(width);
+
+#pragma omp for nowait
+		for (int y = 0; y < height; ++y) {
+			if (cancel && cancel->load(std::memory_order_relaxed)) continue;
+			const unsigned char* row = data + static_cast<size_t>(y) * width * channels;
+			kernels().rgbToLuma(row, lumaRow.data(), width, channels);
+			for (int x = 0; x < width; ++x) {
+				const unsigned char* p = row + static_cast<size_t>(x) * channels;
+				const int r = p[0], g = p[1], b = p[2];
+				++local[0][r];
+				++local[1][g];
+				++local[2][b];
+				++local[3][lumaRow[x]];
+				shadows += std::min(std::min(r, g), b) == 0;
+				highlights += std::max(std::max(r, g), b) == 255;
+			}
+		}
+
+#pragma omp critical
+		{
+			for (size_t c = 0; c < histogramCount; ++c) {
+				for (int v = 0; v < 256; ++v) {
+					stats.histograms[c][v] += local[c][v];
+				}
+			}
+			stats.anyShadowClipped += shadows;
+			stats.anyHighlightClipped += highlights;
+		}
+	}
+
+	for (size_t c = 0; c < histogramCount; ++c) {
+		stats.channels[c] = summarize(stats.histograms[c], stats.pixelCount);
+	}
+	return stats;
+}
+
+ImageStats sampleImageStats(const unsigned char* data, int width, int height, int channels, long long sampleCount) {
+	const long long pixelCount = static_cast<long long>(width) * height;
+	if (!data || pixelCount == 0 || sampleCount >= pixelCount) {
+		return computeImageStats(data, width, height, channels);
+	}
+
+	const int cell = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(pixelCount) / std::max(sampleCount, 1LL))));
+	const int cellsX = (width + cell - 1) / cell;
+	const int cellsY = (height + cell - 1) / cell;
+	const size_t histogramCount = static_cast<size_t>(StatsChannel::Count);
+
+	ImageStats stats;
+	stats.exact = false;
+
+#pragma omp parallel
+	{
+		std::array<std::array<int, 256>, static_cast<size_t>(StatsChannel::Count)> local{};
+		long long shadows = 0, highlights = 0, samples = 0;
+		std::vector<unsigned char> gathered(static_cast<size_t>(cellsX) * channels);
+		std::vector<unsigned char> lumaRow(cellsX);
+
+#pragma omp for nowait
+		for (int cy = 0; cy < cellsY; ++cy) {
+			const int y0 = cy * cell;
+			const int cellHeight = std::min(cell, height - y0);
+			for (int cx = 0; cx < cellsX; ++cx) {
+				const int x0 = cx * cell;
+				const int cellWidth = std::min(cell, width - x0);
+				const unsigned int h = hashCell(cx, cy);
+				const int x = x0 + static_cast<int>(h % cellWidth);
+				const int y = y0 + static_cast<int>((h >> 16) % cellHeight);
+				const unsigned char* p = data + (static_cast<size_t>(y) * width + x) * channels;
+				std::copy(p, p + channels, gathered.data() + static_cast<size_t>(cx) * channels);
+			}
+
+			kernels().rgbToLuma(gathered.data(), lumaRow.data(), cellsX, channels);
+			for (int cx = 0; cx < cellsX; ++cx) {
+				const unsigned char* p = gathered.data() + static_cast<size_t>(cx) * channels;
+				const int r = p[0], g = p[1], b = p[2];
+				++local[0][r];
+				++local[1][g];
+				++local[2][b];
+				++local[3][lumaRow[cx]];
+				shadows += std::min(std::min(r, g), b) == 0;
+				highlights += std::max(std::max(r, g), b) == 255;
+			}
+			samples += cellsX;
+		}
+
+#pragma omp critical
+		{
+			for (size_t c = 0; c < histogramCount; ++c) {
+				for (int v = 0; v < 256; ++v) {
+					stats.histograms[c][v] += local[c][v];
+				}
+			}
+			stats.anyShadowClipped += shadows;
+			stats.anyHighlightClipped += highlights;
+			stats.pixelCount += samples;
+		}
+	}
+
+	for (size_t c = 0; c < histogramCount; ++c) {
+		stats.channels[c] = summarize(stats.histograms[c], stats.pixelCount);
+	}
+	// P(sup |F_n - F| > e) <= 2 exp(-2 n e^2), solved for 5%.
+	stats.cdfErrorBound = std::sqrt(std::log(2.0 / 0.05) / (2.0 * stats.pixelCount));
+	return stats;
+}
+
+BackgroundStats::~BackgroundStats() {
+	cancel();
+}
+
+void BackgroundStats::start(const unsigned char* data, int width, int height, int channels, unsigned long long generation) {
+	cancel();
+	cancelled = false;
+	finished = false;
+	jobGeneration = generation;
+	worker = std::thread([this, data, width, height, channels]() {
+		result = computeImageStats(data, width, height, channels, &cancelled);
+		finished = true;
+	});
+}
+
+bool BackgroundStats::pending(unsigned long long generation) const {
+	return worker.joinable() && jobGeneration == generation;
+}
+
+bool BackgroundStats::take(unsigned long long generation, ImageStats& stats, bool wait) {
+	if (!pending(generation) || (!wait && !finished)) return false;
+	worker.join();
+	stats = std::move(result);
+	return true;
+}
+
+void BackgroundStats::cancel() {
+	if (worker.joinable()) {
+		cancelled = true;
+		worker.join();
+	}
+	jobGeneration = ~0ULL;
+}
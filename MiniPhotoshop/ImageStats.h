@@ -0,0 +1,88 @@
+#ifndef IMAGE_STATS_H
+#define IMAGE_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+enum class StatsChannel {
+    Red = 0,
+    Green,
+    Blue,
+    Luma,
+    Count
+};
+
+struct ChannelStats {
+    int min{ 0 };
+    int max{ 0 };
+    double mean{ 0.0 };
+    double stddev{ 0.0 };
+    // Pixels at 0 and at 255.
+    long long shadowClipped{ 0 };
+    long long highlightClipped{ 0 };
+};
+
+// Everything the UI and the auto tools need about the pixel values,
+// gathered in one pass. Alpha is ignored.
+struct ImageStats {
+    long long pixelCount{ 0 };
+    std::array<std::array<int, 256>, static_cast<size_t>(StatsChannel::Count)> histograms{};
+    std::array<ChannelStats, static_cast<size_t>(StatsChannel::Count)> channels{};
+    // Pixels with at least one color channel at 0 / at 255.
+    long long anyShadowClipped{ 0 };
+    long long anyHighlightClipped{ 0 };
+    // False for sampled estimates. pixelCount is then the number of samples
+    // and every fraction read off the histograms (CDF, percentiles, clipped
+    // shares) is within cdfErrorBound of the exact value with 95% confidence
+    // (Dvoretzky-Kiefer-Wolfowitz).
+    bool exact{ true };
+    double cdfErrorBound{ 0.0 };
+
+    const std::array<int, 256>& histogram(StatsChannel channel) const;
+    const ChannelStats& channel(StatsChannel channel) const;
+
+    // Smallest value v such that at least `fraction` of the pixels (and at
+    // least one) are <= v. 0 gives the minimum, 1 the maximum.
+    int percentile(StatsChannel channel, double fraction) const;
+};
+
+// One parallel sweep over interleaved RGB(A) rows: luma through the
+// dispatched kernel, four histograms and the clipped-pixel counts. The
+// moments, extremes and percentiles are then read off the histograms.
+// A set `cancel` flag makes the remaining rows return immediately.
+ImageStats computeImageStats(const unsigned char* data, int width, int height, int channels, const std::atomic<bool>* cancel = nullptr);
+
+// Estimate from about `sampleCount` pixels, one per cell of a regular grid
+// at a hashed position inside the cell, so every region is represented.
+ImageStats sampleImageStats(const unsigned char* data, int width, int height, int channels, long long sampleCount);
+
+// Runs computeImageStats on a worker thread. The pixels must stay alive and
+// unchanged until the job has been taken or cancelled.
+class BackgroundStats {
+public:
+    BackgroundStats() = default;
+    BackgroundStats(const BackgroundStats&) = delete;
+    BackgroundStats& operator=(const BackgroundStats&) = delete;
+    ~BackgroundStats();
+
+    // Cancels a running job first. `generation` tags the result.
+    void start(const unsigned char* data, int width, int height, int channels, unsigned long long generation);
+    bool pending(unsigned long long generation) const;
+    // Moves the finished result for `generation` into `stats`. With wait set
+    // it blocks until the job is done, otherwise it returns false while the
+    // job is still running.
+    bool take(unsigned long long generation, ImageStats& stats, bool wait);
+    // Stops the job within one row per thread and joins the worker.
+    void cancel();
+
+private:
+    std::thread worker;
+    std::atomic<bool> cancelled{ false };
+    std::atomic<bool> finished{ false };
+    unsigned long long jobGeneration{ ~0ULL };
+    ImageStats result;
+};
+
+#endif // IMAGE_STATS_H
@@ -0,0 +1,49 @@
+#include "Keypoint.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+void sortByResponse(std::vector<Keypoint>& keypoints) {
+	std::stable_sort(keypoints.begin(), keypoints.end(),
+		[](const Keypoint& a, const Keypoint& b) { return a.response > b.response; });
+}
+
+size_t countAbove(const std::vector<Keypoint>& sorted, float threshold) {
+	const auto end = std::partition_point(sorted.begin(), sorted.end(),
+		[threshold](const Keypoint& keypoint) { return keypoint.response > threshold; });
+	return static_cast<size_t>(end - sorted.begin());
+}
+
+void writeKeypointsCsv(const char* path, const Keypoint* keypoints, size_t count) {
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "Cannot write file into path: " << path << std::endl;
+		return;
+	}
+
+	// Enough digits to read every float back exactly.
+	file.precision(9);
+	file << "x,y,response,scale\n";
+	for (size_t i = 0; i < count; ++i) {
+		const Keypoint& keypoint = keypoints[i];
+		file << keypoint.x << ',' << keypoint.y << ',' << keypoint.response << ',' << keypoint.scale << '\n';
+	}
+}
+
+void writeKeypointsBinary(const char* path, const Keypoint* keypoints, size_t count) {
+	static_assert(sizeof(Keypoint) == 4 * sizeof(float), "Keypoint must be four packed floats");
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "Cannot write file into path: " << path << std::endl;
+		return;
+	}
+
+	const std::uint32_t version = 1;
+	const std::uint64_t total = count;
+	file.write("MPKP", 4);
+	file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+	file.write(reinterpret_cast<const char*>(&total), sizeof(total));
+	file.write(reinterpret_cast<const char*>(keypoints), static_cast<std::streamsize>(count * sizeof(Keypoint)));
+}
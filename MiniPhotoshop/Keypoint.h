@@ -0,0 +1,30 @@
+#ifndef KEYPOINT_H
+#define KEYPOINT_H
+
+#include <cstddef>
+#include <vector>
+
+// A detected feature in pixel coordinates. scale is the window sigma the
+// detector used, response its score (higher is stronger).
+struct Keypoint {
+    float x;
+    float y;
+    float response;
+    float scale;
+};
+
+// Strongest first. After sorting, every threshold selects a prefix of the
+// list, so re-thresholding is a binary search instead of a new detection.
+void sortByResponse(std::vector<Keypoint>& keypoints);
+
+// Number of keypoints with response > threshold in a sorted list.
+size_t countAbove(const std::vector<Keypoint>& sorted, float threshold);
+
+// One "x,y,response,scale" line per keypoint after a header line.
+void writeKeypointsCsv(const char* path, const Keypoint* keypoints, size_t count);
+
+// "MPKP", uint32 version (1), uint64 count, then count records of four
+// little-endian float32 values in the order of the Keypoint fields.
+void writeKeypointsBinary(const char* path, const Keypoint* keypoints, size_t count);
+
+#endif // KEYPOINT_H
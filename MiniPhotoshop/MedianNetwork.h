@@ -0,0 +1,74 @@
+#ifndef MEDIAN_NETWORK_H
+#define MEDIAN_NETWORK_H
+
+#include <cstddef>
+
+// Include this after the unit has selected its target instruction set, like
+// SimdCommon.h, so the vector instantiations of the networks are compiled
+// for that set.
+
+namespace {
+
+	// Median selection networks, Paeth's for 9 and Devillard's for 25
+	// inputs. `sort(a, b)` has to leave the minimum in a and the maximum in
+	// b, so the same network runs on bytes and on vectors. p is reordered.
+	template <typename T, typename Sort>
+	T median9(T* p, Sort sort) {
+		sort(p[1], p[2]); sort(p[4], p[5]); sort(p[7], p[8]); sort(p[0], p[1]);
+		sort(p[3], p[4]); sort(p[6], p[7]); sort(p[1], p[2]); sort(p[4], p[5]);
+		sort(p[7], p[8]); sort(p[0], p[3]); sort(p[5], p[8]); sort(p[4], p[7]);
+		sort(p[3], p[6]); sort(p[1], p[4]); sort(p[2], p[5]); sort(p[4], p[7]);
+		sort(p[4], p[2]); sort(p[6], p[4]); sort(p[4], p[2]);
+		return p[4];
+	}
+
+	template <typename T, typename Sort>
+	T median25(T* p, Sort sort) {
+		sort(p[0], p[1]); sort(p[3], p[4]); sort(p[2], p[4]); sort(p[2], p[3]);
+		sort(p[6], p[7]); sort(p[5], p[7]); sort(p[5], p[6]); sort(p[9], p[10]);
+		sort(p[8], p[10]); sort(p[8], p[9]); sort(p[12], p[13]); sort(p[11], p[13]);
+		sort(p[11], p[12]); sort(p[15], p[16]); sort(p[14], p[16]); sort(p[14], p[15]);
+		sort(p[18], p[19]); sort(p[17], p[19]); sort(p[17], p[18]); sort(p[21], p[22]);
+		sort(p[20], p[22]); sort(p[20], p[21]); sort(p[23], p[24]); sort(p[2], p[5]);
+		sort(p[3], p[6]); sort(p[0], p[6]); sort(p[0], p[3]); sort(p[4], p[7]);
+		sort(p[1], p[7]); sort(p[1], p[4]); sort(p[11], p[14]); sort(p[8], p[14]);
+		sort(p[8], p[11]); sort(p[12], p[15]); sort(p[9], p[15]); sort(p[9], p[12]);
+		sort(p[13], p[16]); sort(p[10], p[16]); sort(p[10], p[13]); sort(p[20], p[23]);
+		sort(p[17], p[23]); sort(p[17], p[20]); sort(p[21], p[24]); sort(p[18], p[24]);
+		sort(p[18], p[21]); sort(p[19], p[22]); sort(p[8], p[17]); sort(p[9], p[18]);
+		sort(p[0], p[18]); sort(p[0], p[9]); sort(p[10], p[19]); sort(p[1], p[19]);
+		sort(p[1], p[10]); sort(p[11], p[20]); sort(p[2], p[20]); sort(p[2], p[11]);
+		sort(p[12], p[21]); sort(p[3], p[21]); sort(p[3], p[12]); sort(p[13], p[22]);
+		sort(p[4], p[22]); sort(p[4], p[13]); sort(p[14], p[23]); sort(p[5], p[23]);
+		sort(p[5], p[14]); sort(p[15], p[24]); sort(p[6], p[24]); sort(p[6], p[15]);
+		sort(p[7], p[16]); sort(p[7], p[19]); sort(p[13], p[21]); sort(p[15], p[23]);
+		sort(p[7], p[13]); sort(p[7], p[15]); sort(p[1], p[9]); sort(p[3], p[11]);
+		sort(p[5], p[17]); sort(p[11], p[17]); sort(p[9], p[17]); sort(p[4], p[10]);
+		sort(p[6], p[12]); sort(p[7], p[14]); sort(p[4], p[6]); sort(p[4], p[7]);
+		sort(p[12], p[14]); sort(p[10], p[14]); sort(p[6], p[7]); sort(p[10], p[12]);
+		sort(p[6], p[10]); sort(p[6], p[17]); sort(p[12], p[17]); sort(p[7], p[17]);
+		sort(p[7], p[10]); sort(p[12], p[18]); sort(p[7], p[12]); sort(p[10], p[18]);
+		sort(p[12], p[20]); sort(p[10], p[20]); sort(p[10], p[12]);
+		return p[12];
+	}
+
+	inline void sortBytes(unsigned char& a, unsigned char& b) {
+		const unsigned char low = a < b ? a : b;
+		b = a < b ? b : a;
+		a = low;
+	}
+
+	inline unsigned char medianAt(const unsigned char* const* rows, int size, std::ptrdiff_t i) {
+		unsigned char p[25];
+		const int half = size / 2;
+		for (int r = 0; r < size; ++r) {
+			for (int c = 0; c < size; ++c) {
+				p[r * size + c] = rows[r][i + c - half];
+			}
+		}
+		return size == 3 ? median9(p, sortBytes) : median25(p, sortBytes);
+	}
+
+}
+
+#endif // MEDIAN_NETWORK_H
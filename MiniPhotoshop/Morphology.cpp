@@ -0,0 +1,305 @@
+#include "Morphology.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+	const int TransposeBlock = 32;
+
+	// A line of 2 radius + 1 pixels that advances dx columns per row, or one
+	// along the row when horizontal.
+	struct LinePass {
+		int dx;
+		int radius;
+		bool horizontal;
+	};
+
+	std::vector<LinePass> decompose(StructuringShape shape, int radiusX, int radiusY) {
+		std::vector<LinePass> passes;
+		auto add = [&](int dx, int radius, bool horizontal) {
+			if (radius > 0) passes.push_back({ dx, radius, horizontal });
+		};
+
+		switch (shape) {
+		case StructuringShape::Rectangle:
+			add(0, radiusY, false);
+			add(0, radiusX, true);
+			break;
+		case StructuringShape::HorizontalLine: add(0, radiusX, true); break;
+		case StructuringShape::VerticalLine: add(0, radiusX, false); break;
+		case StructuringShape::DiagonalLine: add(1, radiusX, false); break;
+		case StructuringShape::AntiDiagonalLine: add(-1, radiusX, false); break;
+		case StructuringShape::Octagon: {
+			// The two diagonals reach diagonal * 2 columns and only cover
+			// every other pixel, the square fills the gaps. A regular octagon
+			// has square half side ~ 1.4 times the diagonal radius.
+			const int diagonal = std::min((radiusX * 2 + 3) / 7, (radiusX - 1) / 2);
+			const int square = std::max(radiusX - 2 * diagonal, 1);
+			add(0, square, false);
+			add(1, diagonal, false);
+			add(-1, diagonal, false);
+			add(0, square, true);
+			break;
+		}
+		default: break;
+		}
+		return passes;
+	}
+
+	template <bool Dilate>
+	unsigned char pick(unsigned char a, unsigned char b) {
+		return Dilate ? (a > b ? a : b) : (a < b ? a : b);
+	}
+
+	template <bool Dilate>
+	void pickRow(const unsigned char* a, const unsigned char* b, unsigned char* out, int count) {
+		for (int i = 0; i < count; ++i) out[i] = pick<Dilate>(a[i], b[i]);
+	}
+
+	// van Herk / Gil-Werman along a line that moves dx columns per row. Rows
+	// are extended by `radius` neutral rows on both ends and cut into blocks
+	// of 2 radius + 1; g is the running extreme from the block start, h the
+	// one to the block end, and the window of extended rows [e, e + 2 radius]
+	// is pick(h[e], g[e + 2 radius]) at the columns where the line meets
+	// those rows. Rows carry `radius` + 1 margin columns, because a diagonal
+	// line starting left or right of the image can still reach into it.
+	template <bool Dilate>
+	void linePass(const unsigned char* src, unsigned char* dst, int width, int height, int dx, int radius) {
+		const unsigned char neutral = Dilate ? 0 : 255;
+		const int span = 2 * radius + 1;
+		const int extended = height + 2 * radius;
+		const int margin = radius + 1;
+		const int stride = width + 2 * margin;
+		const int begin = dx != 0 ? -radius : 0;
+		const int end = dx != 0 ? width + radius : width;
+		const int stripRows = std::max(StripRows, 4 * span);
+		const int strips = (height + stripRows - 1) / stripRows;
+
+#pragma omp parallel
+		{
+			std::vector<unsigned char> rows(static_cast<size_t>(2 * stripRows + 3) * stride, neutral);
+			unsigned char* hRows = rows.data() + margin;
+			unsigned char* gRows = hRows + static_cast<size_t>(stripRows) * stride;
+			unsigned char* running[2] = { gRows + static_cast<size_t>(stripRows) * stride, gRows + static_cast<size_t>(stripRows + 1) * stride };
+			unsigned char* input = gRows + static_cast<size_t>(stripRows + 2) * stride;
+
+			// Extended row e with neutral columns and rows outside the image.
+			auto load = [&](int e) -> const unsigned char* {
+				const int y = e - radius;
+				if (y < 0 || y >= height) {
+					std::fill(input + begin, input + end, neutral);
+				}
+				else {
+					std::fill(input + begin, input, neutral);
+					std::copy(src + static_cast<size_t>(y) * width, src + static_cast<size_t>(y + 1) * width, input);
+					std::fill(input + width, input + end, neutral);
+				}
+				return input;
+			};
+
+#pragma omp for schedule(dynamic)
+			for (int s = 0; s < strips; ++s) {
+				const int y0 = s * stripRows;
+				const int y1 = std::min(y0 + stripRows, height);
+
+				// h for extended rows [y0, y1), walking back from the end of
+				// the block that holds y1 - 1.
+				int current = 0;
+				const int hStart = std::min((y1 - 1) / span * span + span - 1, extended - 1);
+				for (int e = hStart; e >= y0; --e) {
+					const unsigned char* f = load(e);
+					unsigned char* h = running[current];
+					if (e % span == span - 1 || e == extended - 1) {
+						std::copy(f + begin, f + end, h + begin);
+					}
+					else {
+						pickRow<Dilate>(f + begin, running[1 - current] + begin + dx, h + begin, end - begin);
+					}
+					if (e < y1) std::copy(h + begin, h + end, hRows + static_cast<size_t>(e - y0) * stride + begin);
+					current = 1 - current;
+				}
+
+				// g for extended rows [y0 + 2 radius, y1 + 2 radius), from the
+				// start of the block that holds the first of them.
+				const int gFirst = y0 + 2 * radius;
+				for (int e = gFirst / span * span; e < y1 + 2 * radius; ++e) {
+					const unsigned char* f = load(e);
+					unsigned char* g = running[current];
+					if (e % span == 0) {
+						std::copy(f + begin, f + end, g + begin);
+					}
+					else {
+						pickRow<Dilate>(f + begin, running[1 - current] + begin - dx, g + begin, end - begin);
+					}
+					if (e >= gFirst) std::copy(g + begin, g + end, gRows + static_cast<size_t>(e - gFirst) * stride + begin);
+					current = 1 - current;
+				}
+
+				for (int y = y0; y < y1; ++y) {
+					const unsigned char* h = hRows + static_cast<size_t>(y - y0) * stride - dx * radius;
+					const unsigned char* g = gRows + static_cast<size_t>(y - y0) * stride + dx * radius;
+					pickRow<Dilate>(h, g, dst + static_cast<size_t>(y) * width, width);
+				}
+			}
+		}
+	}
+
+	void transpose(const unsigned char* src, unsigned char* dst, int width, int height) {
+		const int blocksY = (height + TransposeBlock - 1) / TransposeBlock;
+#pragma omp parallel for schedule(static)
+		for (int by = 0; by < blocksY; ++by) {
+			const int y0 = by * TransposeBlock;
+			const int y1 = std::min(y0 + TransposeBlock, height);
+			for (int x0 = 0; x0 < width; x0 += TransposeBlock) {
+				const int x1 = std::min(x0 + TransposeBlock, width);
+				for (int y = y0; y < y1; ++y) {
+					for (int x = x0; x < x1; ++x) {
+						dst[static_cast<size_t>(x) * height + y] = src[static_cast<size_t>(y) * width + x];
+					}
+				}
+			}
+		}
+	}
+
+	// Runs the passes over `plane` in place. Row passes go first, so the
+	// horizontal ones need a single transpose there and back.
+	template <bool Dilate>
+	void runPasses(std::vector<unsigned char>& plane, std::vector<unsigned char>& scratch, int width, int height, const std::vector<LinePass>& passes) {
+		for (const LinePass& pass : passes) {
+			if (pass.horizontal) continue;
+			linePass<Dilate>(plane.data(), scratch.data(), width, height, pass.dx, pass.radius);
+			plane.swap(scratch);
+		}
+
+		bool transposed = false;
+		for (const LinePass& pass : passes) {
+			if (!pass.horizontal) continue;
+			if (!transposed) {
+				transpose(plane.data(), scratch.data(), width, height);
+				plane.swap(scratch);
+				transposed = true;
+			}
+			linePass<Dilate>(plane.data(), scratch.data(), height, width, 0, pass.radius);
+			plane.swap(scratch);
+		}
+		if (transposed) {
+			transpose(plane.data(), scratch.data(), height, width);
+			plane.swap(scratch);
+		}
+	}
+
+	// Each pass takes everything outside the plane as neutral. That is
+	// exact for vertical then horizontal lines, but a diagonal pass would
+	// also read rows outside the image that an earlier pass has already
+	// reached into, so shapes with diagonals run on a plane padded by the
+	// reach of their passes.
+	template <bool Dilate>
+	void applyPasses(std::vector<unsigned char>& plane, std::vector<unsigned char>& scratch, int width, int height, const std::vector<LinePass>& passes) {
+		int padX = 0;
+		int padY = 0;
+		for (const LinePass& pass : passes) {
+			if (pass.dx != 0) padX += pass.radius;
+			if (!pass.horizontal) padY += pass.radius;
+		}
+		if (padX == 0) {
+			runPasses<Dilate>(plane, scratch, width, height, passes);
+			return;
+		}
+
+		const int paddedWidth = width + 2 * padX;
+		const int paddedHeight = height + 2 * padY;
+		std::vector<unsigned char> padded(static_cast<size_t>(paddedWidth) * paddedHeight, Dilate ? 0 : 255);
+		std::vector<unsigned char> paddedScratch(padded.size());
+		for (int y = 0; y < height; ++y) {
+			std::copy(plane.begin() + static_cast<size_t>(y) * width, plane.begin() + static_cast<size_t>(y + 1) * width,
+				padded.begin() + static_cast<size_t>(y + padY) * paddedWidth + padX);
+		}
+		runPasses<Dilate>(padded, paddedScratch, paddedWidth, paddedHeight, passes);
+		for (int y = 0; y < height; ++y) {
+			const auto row = padded.begin() + static_cast<size_t>(y + padY) * paddedWidth + padX;
+			std::copy(row, row + width, plane.begin() + static_cast<size_t>(y) * width);
+		}
+	}
+
+	void subtract(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, std::vector<unsigned char>& out) {
+		const size_t count = out.size();
+		for (size_t i = 0; i < count; ++i) out[i] = static_cast<unsigned char>(a[i] - b[i]);
+	}
+
+}
+
+const char* morphologyOperationName(MorphologyOperation operation) {
+	switch (operation) {
+	case MorphologyOperation::Erode: return "Erode";
+	case MorphologyOperation::Dilate: return "Dilate";
+	case MorphologyOperation::Open: return "Open";
+	case MorphologyOperation::Close: return "Close";
+	case MorphologyOperation::TopHat: return "Top-hat";
+	case MorphologyOperation::BlackHat: return "Black-hat";
+	case MorphologyOperation::Gradient: return "Gradient";
+	default: return "Unknown";
+	}
+}
+
+const char* structuringShapeName(StructuringShape shape) {
+	switch (shape) {
+	case StructuringShape::Rectangle: return "Rectangle";
+	case StructuringShape::HorizontalLine: return "Horizontal line";
+	case StructuringShape::VerticalLine: return "Vertical line";
+	case StructuringShape::DiagonalLine: return "Diagonal line (\\)";
+	case StructuringShape::AntiDiagonalLine: return "Diagonal line (/)";
+	case StructuringShape::Octagon: return "Octagon";
+	default: return "Unknown";
+	}
+}
+
+void morphology(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	MorphologyOperation operation, StructuringShape shape, int radiusX, int radiusY) {
+	if (width <= 0 || height <= 0) return;
+	planes = std::min(planes, channels);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	for (int c = planes; c < channels; ++c) {
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = src[i * channels + c];
+	}
+
+	const std::vector<LinePass> passes = decompose(shape, std::max(radiusX, 0), std::max(radiusY, 0));
+	std::vector<unsigned char> original(pixelCount), first(pixelCount), second(pixelCount), scratch(pixelCount);
+	for (int c = 0; c < planes; ++c) {
+		for (size_t i = 0; i < pixelCount; ++i) original[i] = src[i * channels + c];
+		first = original;
+
+		const std::vector<unsigned char>* result = &first;
+		switch (operation) {
+		case MorphologyOperation::Erode:
+			applyPasses<false>(first, scratch, width, height, passes);
+			break;
+		case MorphologyOperation::Dilate:
+			applyPasses<true>(first, scratch, width, height, passes);
+			break;
+		case MorphologyOperation::Open:
+		case MorphologyOperation::TopHat:
+			applyPasses<false>(first, scratch, width, height, passes);
+			applyPasses<true>(first, scratch, width, height, passes);
+			if (operation == MorphologyOperation::TopHat) subtract(original, first, first);
+			break;
+		case MorphologyOperation::Close:
+		case MorphologyOperation::BlackHat:
+			applyPasses<true>(first, scratch, width, height, passes);
+			applyPasses<false>(first, scratch, width, height, passes);
+			if (operation == MorphologyOperation::BlackHat) subtract(first, original, first);
+			break;
+		case MorphologyOperation::Gradient:
+			second = original;
+			applyPasses<true>(first, scratch, width, height, passes);
+			applyPasses<false>(second, scratch, width, height, passes);
+			subtract(first, second, first);
+			break;
+		default:
+			result = &original;
+			break;
+		}
+
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = (*result)[i];
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+enum class MorphologyOperation {
+    Erode = 0,
+    Dilate,
+    // Dilation of the erosion.
+    Open,
+    // Erosion of the dilation.
+    Close,
+    // Image minus its opening: bright details smaller than the element.
+    TopHat,
+    // Closing minus the image: dark details smaller than the element.
+    BlackHat,
+    // Dilation minus erosion.
+    Gradient,
+    Count
+};
+
+enum class StructuringShape {
+    // (2 radiusX + 1) x (2 radiusY + 1) pixels.
+    Rectangle = 0,
+    // Lines of 2 radiusX + 1 pixels.
+    HorizontalLine,
+    VerticalLine,
+    // Top left to bottom right.
+    DiagonalLine,
+    // Top right to bottom left.
+    AntiDiagonalLine,
+    // Disk approximation of radius radiusX: a square plus both diagonal
+    // lines, so it decomposes like the rectangle.
+    Octagon,
+    Count
+};
+
+const char* morphologyOperationName(MorphologyOperation operation);
+const char* structuringShapeName(StructuringShape shape);
+
+// Grayscale morphology of the first `planes` channels of interleaved 8-bit
+// pixels; the rest are copied. Every shape is a sequence of line passes and
+// each line pass is a van Herk / Gil-Werman min or max filter: three
+// comparisons per pixel whatever the length. Vertical and diagonal passes
+// combine whole rows at a time, so they vectorize along the row; horizontal
+// passes run on the transposed plane. Pixels outside the image are ignored.
+void morphology(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    MorphologyOperation operation, StructuringShape shape, int radiusX, int radiusY);
+
+#endif // MORPHOLOGY_H
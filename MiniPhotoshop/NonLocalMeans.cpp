@@ -0,0 +1,192 @@
+#include "NonLocalMeans.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	// Output tiles are always this size, edge tiles are computed in full and
+	// cropped, so the inner loops have a fixed trip count.
+	const int TileSize = 64;
+	const int WeightTableSize = 4096;
+	// Mean squared differences of more than WeightCutoff h^2 get weight 0.
+	const float WeightCutoff = 8.0f;
+
+	// Per-thread buffers for one tile at a time.
+	class NonLocalMeansTile {
+	public:
+		NonLocalMeansTile(const unsigned char* src, int width, int height, int channels, int planes,
+			int patchRadius, int searchRadius, const std::vector<float>& weights, float weightScale)
+			: src(src), width(width), height(height), channels(channels), planes(planes),
+			patchRadius(patchRadius), searchRadius(searchRadius), weights(weights), weightScale(weightScale),
+			regionSize(TileSize + 2 * (searchRadius + patchRadius)),
+			diffSize(TileSize + 2 * patchRadius),
+			region(static_cast<size_t>(planes) * regionSize * regionSize),
+			diff(static_cast<size_t>(diffSize) * diffSize),
+			columns(diffSize),
+			prefix(diffSize + 1),
+			weightSum(TileSize * TileSize),
+			valueSum(static_cast<size_t>(planes) * TileSize * TileSize) {
+		}
+
+		void run(unsigned char* dst, int x0, int y0) {
+			loadRegion(x0, y0);
+			std::fill(weightSum.begin(), weightSum.end(), 0.0f);
+			std::fill(valueSum.begin(), valueSum.end(), 0.0f);
+			for (int dy = -searchRadius; dy <= searchRadius; ++dy) {
+				for (int dx = -searchRadius; dx <= searchRadius; ++dx) {
+					accumulateOffset(dx, dy);
+				}
+			}
+			store(dst, x0, y0);
+		}
+
+	private:
+		// The tile plus searchRadius + patchRadius on every side, planar.
+		void loadRegion(int x0, int y0) {
+			const int margin = searchRadius + patchRadius;
+			for (int ry = 0; ry < regionSize; ++ry) {
+				const int sy = std::min(std::max(y0 - margin + ry, 0), height - 1);
+				const unsigned char* row = src + static_cast<size_t>(sy) * width * channels;
+				for (int rx = 0; rx < regionSize; ++rx) {
+					const int sx = std::min(std::max(x0 - margin + rx, 0), width - 1);
+					for (int c = 0; c < planes; ++c) {
+						regionAt(c, ry)[rx] = row[static_cast<size_t>(sx) * channels + c];
+					}
+				}
+			}
+		}
+
+		int* regionAt(int plane, int row) {
+			return region.data() + (static_cast<size_t>(plane) * regionSize + row) * regionSize;
+		}
+
+		void accumulateOffset(int dx, int dy) {
+			// Squared differences for the tile plus patchRadius on every side.
+			for (int j = 0; j < diffSize; ++j) {
+				int* out = diff.data() + static_cast<size_t>(j) * diffSize;
+				std::fill(out, out + diffSize, 0);
+				for (int c = 0; c < planes; ++c) {
+					const int* a = regionAt(c, j + searchRadius) + searchRadius;
+					const int* b = regionAt(c, j + searchRadius + dy) + searchRadius + dx;
+					for (int i = 0; i < diffSize; ++i) {
+						const int d = a[i] - b[i];
+						out[i] += d * d;
+					}
+				}
+			}
+
+			// Patch sums: running column sums down the tile, then a prefix sum
+			// along every row.
+			const int patch = 2 * patchRadius + 1;
+			std::fill(columns.begin(), columns.end(), 0);
+			for (int j = 0; j < patch; ++j) {
+				const int* row = diffRow(j);
+				for (int i = 0; i < diffSize; ++i) columns[i] += row[i];
+			}
+			const float maxIndex = static_cast<float>(WeightTableSize - 1);
+			for (int y = 0; y < TileSize; ++y) {
+				if (y > 0) {
+					const int* entering = diffRow(y + patch - 1);
+					const int* leaving = diffRow(y - 1);
+					for (int i = 0; i < diffSize; ++i) columns[i] += entering[i] - leaving[i];
+				}
+
+				prefix[0] = 0;
+				for (int i = 0; i < diffSize; ++i) prefix[i + 1] = prefix[i] + columns[i];
+
+				float* weightRow = weightSum.data() + static_cast<size_t>(y) * TileSize;
+				float rowWeights[TileSize];
+				for (int x = 0; x < TileSize; ++x) {
+					const float index = std::min(static_cast<float>(prefix[x + patch] - prefix[x]) * weightScale, maxIndex);
+					rowWeights[x] = weights[static_cast<int>(index)];
+				}
+				for (int x = 0; x < TileSize; ++x) weightRow[x] += rowWeights[x];
+				const int margin = searchRadius + patchRadius;
+				for (int c = 0; c < planes; ++c) {
+					const int* candidates = regionAt(c, y + margin + dy) + margin + dx;
+					float* sums = valueSum.data() + (static_cast<size_t>(c) * TileSize + y) * TileSize;
+					for (int x = 0; x < TileSize; ++x) sums[x] += rowWeights[x] * static_cast<float>(candidates[x]);
+				}
+			}
+		}
+
+		const int* diffRow(int j) const {
+			return diff.data() + static_cast<size_t>(j) * diffSize;
+		}
+
+		void store(unsigned char* dst, int x0, int y0) {
+			const int rows = std::min(TileSize, height - y0);
+			const int cols = std::min(TileSize, width - x0);
+			for (int y = 0; y < rows; ++y) {
+				unsigned char* out = dst + (static_cast<size_t>(y0 + y) * width + x0) * channels;
+				for (int x = 0; x < cols; ++x) {
+					const size_t i = static_cast<size_t>(y) * TileSize + x;
+					for (int c = 0; c < planes; ++c) {
+						const float value = valueSum[static_cast<size_t>(c) * TileSize * TileSize + i] / weightSum[i];
+						out[static_cast<size_t>(x) * channels + c] = static_cast<unsigned char>(std::min(value + 0.5f, 255.0f));
+					}
+				}
+			}
+		}
+
+		const unsigned char* src;
+		int width;
+		int height;
+		int channels;
+		int planes;
+		int patchRadius;
+		int searchRadius;
+		const std::vector<float>& weights;
+		float weightScale;
+		int regionSize;
+		int diffSize;
+		std::vector<int> region;
+		std::vector<int> diff;
+		std::vector<int> columns;
+		std::vector<int> prefix;
+		std::vector<float> weightSum;
+		std::vector<float> valueSum;
+	};
+
+}
+
+void nonLocalMeans(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	const NonLocalMeansParameters& params) {
+	if (width <= 0 || height <= 0) return;
+	planes = std::min(planes, channels);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	for (int c = planes; c < channels; ++c) {
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = src[i * channels + c];
+	}
+	if (planes <= 0) return;
+
+	const int patchRadius = std::min(std::max(params.patchRadius, 0), MaxNonLocalMeansRadius);
+	const int searchRadius = std::min(std::max(params.searchRadius, 0), MaxNonLocalMeansRadius);
+	const float strength = std::max(params.strength, 0.1f);
+
+	// Weights by table index, the last entry is the cutoff. Entry 0 is 1 so
+	// the pixel itself, at distance 0, always counts fully.
+	std::vector<float> weights(WeightTableSize);
+	for (int k = 0; k < WeightTableSize - 1; ++k) {
+		weights[k] = std::exp(-WeightCutoff * k / WeightTableSize);
+	}
+	weights[WeightTableSize - 1] = 0.0f;
+	const int patch = 2 * patchRadius + 1;
+	const float samples = static_cast<float>(patch * patch * planes);
+	const float weightScale = WeightTableSize / (WeightCutoff * strength * strength * samples);
+
+	const int tilesX = (width + TileSize - 1) / TileSize;
+	const int tilesY = (height + TileSize - 1) / TileSize;
+	const int tiles = tilesX * tilesY;
+
+#pragma omp parallel
+	{
+		NonLocalMeansTile tile(src, width, height, channels, planes, patchRadius, searchRadius, weights, weightScale);
+
+#pragma omp for schedule(dynamic)
+		for (int t = 0; t < tiles; ++t) {
+			tile.run(dst, (t % tilesX) * TileSize, (t / tilesX) * TileSize);
+		}
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef NON_LOCAL_MEANS_H
+#define NON_LOCAL_MEANS_H
+
+const int MaxNonLocalMeansRadius = 32;
+
+struct NonLocalMeansParameters {
+    // Filter strength h in levels, about the noise sigma works well.
+    float strength{ 10.0f };
+    // Patches are (2 patchRadius + 1)^2 pixels.
+    int patchRadius{ 3 };
+    // Candidates come from the (2 searchRadius + 1)^2 window.
+    int searchRadius{ 7 };
+};
+
+// Non-local means of the first `planes` channels of interleaved 8-bit
+// pixels, the rest are copied. Every pixel becomes the mean of the pixels in
+// its search window weighted by exp(-d / h^2), with d the mean squared
+// difference of the patches around them, so the pixel itself has weight 1.
+// Distances are computed per search offset: one difference image, then box
+// sums from running column sums, so the cost does not depend on the patch
+// size. Tiles run in parallel. Pixels outside the image replicate the edge.
+void nonLocalMeans(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    const NonLocalMeansParameters& params);
+
+#endif // NON_LOCAL_MEANS_H
@@ -0,0 +1,211 @@
+#include "Pyramid.h"
+#include <algorithm>
+
+namespace {
+
+	// Rows of the expanded image come from at most three coarse rows. Even
+	// rows 2j use j - 1, j, j + 1 with weights 1 6 1, odd rows 2j + 1 use
+	// j and j + 1 with weights 4 4 (all over 8). Columns work the same way.
+	struct ExpandTaps {
+		int index[3];
+		int weight[3];
+	};
+
+	ExpandTaps expandTaps(int fine, int coarseSize, BorderMode border) {
+		ExpandTaps taps{};
+		const int j = fine / 2;
+		if (fine % 2 == 0) {
+			taps.index[0] = borderCoordinate(j - 1, coarseSize, border);
+			taps.index[1] = borderCoordinate(j, coarseSize, border);
+			taps.index[2] = borderCoordinate(j + 1, coarseSize, border);
+			taps.weight[0] = 1;
+			taps.weight[1] = 6;
+			taps.weight[2] = 1;
+		}
+		else {
+			taps.index[0] = borderCoordinate(j, coarseSize, border);
+			taps.index[1] = borderCoordinate(j + 1, coarseSize, border);
+			taps.index[2] = -1;
+			taps.weight[0] = 4;
+			taps.weight[1] = 4;
+			taps.weight[2] = 0;
+		}
+		for (int t = 0; t < 3; ++t) {
+			if (taps.index[t] < 0) taps.weight[t] = 0;
+		}
+		return taps;
+	}
+
+	// Row y of expand(coarse) at width x height, scaled by 64.
+	void expandRow(const ImageLevel& coarse, int y, int width, BorderMode border,
+		const std::vector<ExpandTaps>& columnTaps, int* columnSums, int* out) {
+		const int channels = coarse.channels;
+		const size_t coarseStride = static_cast<size_t>(coarse.width) * channels;
+		const ExpandTaps rowTaps = expandTaps(y, coarse.height, border);
+
+		std::fill(columnSums, columnSums + coarseStride, 0);
+		for (int t = 0; t < 3; ++t) {
+			if (rowTaps.weight[t] == 0) continue;
+			const unsigned char* row = coarse.pixels.data() + rowTaps.index[t] * coarseStride;
+			const int weight = rowTaps.weight[t];
+			for (size_t i = 0; i < coarseStride; ++i) {
+				columnSums[i] += weight * row[i];
+			}
+		}
+
+		auto borderPixel = [&](int x) {
+			const ExpandTaps& taps = columnTaps[x];
+			for (int c = 0; c < channels; ++c) {
+				int sum = 0;
+				for (int t = 0; t < 3; ++t) {
+					if (taps.weight[t] != 0) {
+						sum += taps.weight[t] * columnSums[taps.index[t] * channels + c];
+					}
+				}
+				out[x * channels + c] = sum;
+			}
+		};
+
+		// Interior coarse columns j produce output columns 2j and 2j + 1
+		// without border lookups.
+		const int interiorEnd = std::min(coarse.width - 1, width / 2);
+		borderPixel(0);
+		if (width > 1) borderPixel(1);
+		for (int j = 1; j < interiorEnd; ++j) {
+			const int* previous = columnSums + (j - 1) * channels;
+			const int* current = previous + channels;
+			const int* next = current + channels;
+			int* even = out + 2 * j * channels;
+			int* odd = even + channels;
+			for (int c = 0; c < channels; ++c) {
+				even[c] = previous[c] + 6 * current[c] + next[c];
+				odd[c] = 4 * (current[c] + next[c]);
+			}
+		}
+		for (int x = std::max(2, 2 * interiorEnd); x < width; ++x) borderPixel(x);
+	}
+
+	std::vector<ExpandTaps> expandColumnTaps(int width, int coarseWidth, BorderMode border) {
+		std::vector<ExpandTaps> taps(width);
+		for (int x = 0; x < width; ++x) {
+			taps[x] = expandTaps(x, coarseWidth, border);
+		}
+		return taps;
+	}
+
+}
+
+int pyramidSize(int size) {
+	return (size + 1) / 2;
+}
+
+void pyrDown(const unsigned char* src, int width, int height, int channels, BorderMode border, ImageLevel& dst) {
+	static const int taps[5] = { 1, 4, 6, 4, 1 };
+	dst.width = pyramidSize(width);
+	dst.height = pyramidSize(height);
+	dst.channels = channels;
+	dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * channels);
+
+	const size_t srcStride = static_cast<size_t>(width) * channels;
+	const size_t dstStride = static_cast<size_t>(dst.width) * channels;
+	const int rows = dst.height;
+
+#pragma omp parallel
+	{
+		std::vector<int> columnSums(srcStride);
+#pragma omp for
+		for (int y = 0; y < rows; ++y) {
+			std::fill(columnSums.begin(), columnSums.end(), 0);
+			for (int t = 0; t < 5; ++t) {
+				const int sy = borderCoordinate(2 * y + t - 2, height, border);
+				if (sy < 0) continue;
+				const unsigned char* row = src + sy * srcStride;
+				const int weight = taps[t];
+				for (size_t i = 0; i < srcStride; ++i) {
+					columnSums[i] += weight * row[i];
+				}
+			}
+
+			unsigned char* out = dst.pixels.data() + y * dstStride;
+			auto borderPixel = [&](int x) {
+				for (int c = 0; c < channels; ++c) {
+					int sum = 0;
+					for (int t = 0; t < 5; ++t) {
+						const int cx = borderCoordinate(2 * x + t - 2, width, border);
+						if (cx >= 0) sum += taps[t] * columnSums[cx * channels + c];
+					}
+					out[x * channels + c] = static_cast<unsigned char>((sum + 128) >> 8);
+				}
+			};
+
+			// Output columns whose five source columns are all inside.
+			const int interiorBegin = std::min(1, dst.width);
+			const int interiorEnd = std::max(interiorBegin, std::min(dst.width, (width - 1) / 2));
+			for (int x = 0; x < interiorBegin; ++x) borderPixel(x);
+			for (int x = interiorBegin; x < interiorEnd; ++x) {
+				const int* p = columnSums.data() + (2 * x - 2) * channels;
+				unsigned char* o = out + x * channels;
+				for (int c = 0; c < channels; ++c) {
+					const int sum = p[c] + 4 * p[channels + c] + 6 * p[2 * channels + c] + 4 * p[3 * channels + c] + p[4 * channels + c];
+					o[c] = static_cast<unsigned char>((sum + 128) >> 8);
+				}
+			}
+			for (int x = interiorEnd; x < dst.width; ++x) borderPixel(x);
+		}
+	}
+}
+
+void pyrLaplacian(const unsigned char* fine, int width, int height, const ImageLevel& coarse, BorderMode border, LaplacianLevel& dst) {
+	const int channels = coarse.channels;
+	dst.width = width;
+	dst.height = height;
+	dst.channels = channels;
+	dst.pixels.resize(static_cast<size_t>(width) * height * channels);
+
+	const std::vector<ExpandTaps> columnTaps = expandColumnTaps(width, coarse.width, border);
+	const size_t stride = static_cast<size_t>(width) * channels;
+
+#pragma omp parallel
+	{
+		std::vector<int> columnSums(static_cast<size_t>(coarse.width) * channels);
+		std::vector<int> expanded(stride);
+#pragma omp for
+		for (int y = 0; y < height; ++y) {
+			expandRow(coarse, y, width, border, columnTaps, columnSums.data(), expanded.data());
+			const unsigned char* src = fine + y * stride;
+			short* out = dst.pixels.data() + y * stride;
+			for (size_t i = 0; i < stride; ++i) {
+				out[i] = static_cast<short>(src[i] - ((expanded[i] + 32) >> 6));
+			}
+		}
+	}
+}
+
+void pyrReconstruct(const ImageLevel& coarse, const LaplacianLevel& laplacian, BorderMode border, ImageLevel& dst) {
+	const int width = laplacian.width;
+	const int height = laplacian.height;
+	const int channels = laplacian.channels;
+	dst.width = width;
+	dst.height = height;
+	dst.channels = channels;
+	dst.pixels.resize(static_cast<size_t>(width) * height * channels);
+
+	const std::vector<ExpandTaps> columnTaps = expandColumnTaps(width, coarse.width, border);
+	const size_t stride = static_cast<size_t>(width) * channels;
+
+#pragma omp parallel
+	{
+		std::vector<int> columnSums(static_cast<size_t>(coarse.width) * channels);
+		std::vector<int> expanded(stride);
+#pragma omp for
+		for (int y = 0; y < height; ++y) {
+			expandRow(coarse, y, width, border, columnTaps, columnSums.data(), expanded.data());
+			const short* src = laplacian.pixels.data() + y * stride;
+			unsigned char* out = dst.pixels.data() + y * stride;
+			for (size_t i = 0; i < stride; ++i) {
+				const int value = ((expanded[i] + 32) >> 6) + src[i];
+				out[i] = static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+			}
+		}
+	}
+}
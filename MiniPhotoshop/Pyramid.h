@@ -0,0 +1,40 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <vector>
+
+#include "Stencil3x3.h"
+
+// Interleaved 8-bit image with the channel count of its source.
+struct ImageLevel {
+    int width{ 0 };
+    int height{ 0 };
+    int channels{ 0 };
+    std::vector<unsigned char> pixels;
+};
+
+// Difference between a Gaussian level and the expansion of the next one,
+// in [-255, 255].
+struct LaplacianLevel {
+    int width{ 0 };
+    int height{ 0 };
+    int channels{ 0 };
+    std::vector<short> pixels;
+};
+
+// Size of the level below width x height: halved, rounded up.
+int pyramidSize(int size);
+
+// 5-tap binomial filter (1 4 6 4 1) / 16 in both directions followed by
+// dropping every second row and column. Parallel over output rows.
+void pyrDown(const unsigned char* src, int width, int height, int channels, BorderMode border, ImageLevel& dst);
+
+// Expands `coarse` to width x height (at most twice its size) with the same
+// filter and stores fine - expand(coarse).
+void pyrLaplacian(const unsigned char* fine, int width, int height, const ImageLevel& coarse, BorderMode border, LaplacianLevel& dst);
+
+// Inverse of pyrLaplacian: expand(coarse) + laplacian, clamped to 8 bits.
+// Exact when `coarse` is the level the Laplacian was built from.
+void pyrReconstruct(const ImageLevel& coarse, const LaplacianLevel& laplacian, BorderMode border, ImageLevel& dst);
+
+#endif // PYRAMID_H
@@ -0,0 +1,209 @@
+#include "RankFilter.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+	const int Bins = 256;
+	const int CoarseBins = 16;
+
+	// Channel c of row y with the border rule on both axes, padded by `pad`
+	// samples on either side.
+	void loadPlaneRow(const unsigned char* src, int width, int height, int channels, int c, int y, int pad, BorderMode border, unsigned char* out) {
+		const int sy = borderCoordinate(y, height, border);
+		if (sy < 0) {
+			std::fill(out, out + width + 2 * pad, static_cast<unsigned char>(0));
+			return;
+		}
+		const unsigned char* row = src + static_cast<size_t>(sy) * width * channels + c;
+		for (int x = -pad; x < width + pad; ++x) {
+			const int sx = (x >= 0 && x < width) ? x : borderCoordinate(x, width, border);
+			out[x + pad] = sx < 0 ? 0 : row[static_cast<size_t>(sx) * channels];
+		}
+	}
+
+	void storePlaneRow(const unsigned char* values, int width, int channels, int c, unsigned char* dst) {
+		for (int x = 0; x < width; ++x) {
+			dst[static_cast<size_t>(x) * channels + c] = values[x];
+		}
+	}
+
+	// 3x3 or 5x5 median of rows [y0, y1) over a ring of padded rows.
+	void medianStrip(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int c,
+		int y0, int y1, int radius, BorderMode border, std::vector<unsigned char>& ring, std::vector<unsigned char>& out) {
+		const int size = 2 * radius + 1;
+		const size_t stride = static_cast<size_t>(width) + 2 * radius;
+		ring.resize(stride * size);
+		out.resize(width);
+		auto slot = [&](int y) { return ring.data() + static_cast<size_t>(((y % size) + size) % size) * stride; };
+
+		for (int y = y0 - radius; y < y0 + radius; ++y) {
+			loadPlaneRow(src, width, height, channels, c, y, radius, border, slot(y));
+		}
+		const unsigned char* rows[5];
+		for (int y = y0; y < y1; ++y) {
+			loadPlaneRow(src, width, height, channels, c, y + radius, radius, border, slot(y + radius));
+			for (int r = 0; r < size; ++r) {
+				rows[r] = slot(y - radius + r) + radius;
+			}
+			kernels().medianRow(rows, size, out.data(), width);
+			storePlaneRow(out.data(), width, channels, c, dst + static_cast<size_t>(y) * width * channels);
+		}
+	}
+
+	// Per-column histograms of the window rows, each with 16 coarse bins
+	// (the high nibble) next to the 256 fine ones. Columns outside the image
+	// are resolved through `columnOf`; -1 stands for a column of zeros.
+	struct ColumnHistograms {
+		std::vector<unsigned short> fine;
+		std::vector<unsigned short> coarse;
+		std::vector<int> columnOf;
+		unsigned short zeroFine[Bins];
+		unsigned short zeroCoarse[CoarseBins];
+
+		const unsigned short* fineAt(int x, int radius) const {
+			const int column = columnOf[x + radius];
+			return column < 0 ? zeroFine : fine.data() + static_cast<size_t>(column) * Bins;
+		}
+
+		const unsigned short* coarseAt(int x, int radius) const {
+			const int column = columnOf[x + radius];
+			return column < 0 ? zeroCoarse : coarse.data() + static_cast<size_t>(column) * CoarseBins;
+		}
+	};
+
+	void addRow(ColumnHistograms& h, const unsigned char* src, int width, int height, int channels, int c, int y, BorderMode border, int delta) {
+		const int sy = borderCoordinate(y, height, border);
+		for (int x = 0; x < width; ++x) {
+			const int value = sy < 0 ? 0 : src[(static_cast<size_t>(sy) * width + x) * channels + c];
+			h.fine[static_cast<size_t>(x) * Bins + value] += static_cast<unsigned short>(delta);
+			h.coarse[static_cast<size_t>(x) * CoarseBins + (value >> 4)] += static_cast<unsigned short>(delta);
+		}
+	}
+
+	// Perreault-Hebert: the window histogram slides one column at a time by
+	// adding the entering and removing the leaving column histogram. Only
+	// the coarse bins are kept current; a fine bucket is brought up to date
+	// when the rank falls into it, by replaying the columns it missed or by
+	// summing the window again, whichever is shorter.
+	void histogramStrip(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int c,
+		int y0, int y1, int radius, int rank, BorderMode border, ColumnHistograms& h, std::vector<unsigned char>& out) {
+		const int size = 2 * radius + 1;
+		h.fine.assign(static_cast<size_t>(width) * Bins, 0);
+		h.coarse.assign(static_cast<size_t>(width) * CoarseBins, 0);
+		out.resize(width);
+		for (int y = y0 - radius; y <= y0 + radius; ++y) {
+			addRow(h, src, width, height, channels, c, y, border, 1);
+		}
+
+		for (int y = y0; y < y1; ++y) {
+			if (y > y0) {
+				addRow(h, src, width, height, channels, c, y - radius - 1, border, -1);
+				addRow(h, src, width, height, channels, c, y + radius, border, 1);
+			}
+
+			unsigned short coarse[CoarseBins] = {};
+			unsigned short fine[Bins];
+			int updated[CoarseBins];
+			std::fill(updated, updated + CoarseBins, -size);
+			for (int x = -radius; x <= radius; ++x) {
+				const unsigned short* column = h.coarseAt(x, radius);
+				for (int b = 0; b < CoarseBins; ++b) coarse[b] += column[b];
+			}
+
+			for (int x = 0; x < width; ++x) {
+				if (x > 0) {
+					const unsigned short* entering = h.coarseAt(x + radius, radius);
+					const unsigned short* leaving = h.coarseAt(x - radius - 1, radius);
+					for (int b = 0; b < CoarseBins; ++b) coarse[b] += entering[b] - leaving[b];
+				}
+
+				int below = 0;
+				int bucket = 0;
+				while (below + coarse[bucket] <= rank) below += coarse[bucket++];
+
+				unsigned short* bins = fine + bucket * CoarseBins;
+				if (2 * (x - updated[bucket]) > size) {
+					std::fill(bins, bins + CoarseBins, static_cast<unsigned short>(0));
+					for (int wx = x - radius; wx <= x + radius; ++wx) {
+						const unsigned short* column = h.fineAt(wx, radius) + bucket * CoarseBins;
+						for (int b = 0; b < CoarseBins; ++b) bins[b] += column[b];
+					}
+				}
+				else {
+					for (int wx = updated[bucket] + 1; wx <= x; ++wx) {
+						const unsigned short* entering = h.fineAt(wx + radius, radius) + bucket * CoarseBins;
+						const unsigned short* leaving = h.fineAt(wx - radius - 1, radius) + bucket * CoarseBins;
+						for (int b = 0; b < CoarseBins; ++b) bins[b] += entering[b] - leaving[b];
+					}
+				}
+				updated[bucket] = x;
+
+				int value = 0;
+				while (below + bins[value] <= rank) below += bins[value++];
+				out[x] = static_cast<unsigned char>(bucket * CoarseBins + value);
+			}
+			storePlaneRow(out.data(), width, channels, c, dst + static_cast<size_t>(y) * width * channels);
+		}
+	}
+
+}
+
+void rankFilter(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	int radius, float percentile, BorderMode border) {
+	if (width <= 0 || height <= 0) return;
+	radius = std::min(std::max(radius, 0), MaxRankRadius);
+	planes = std::min(planes, channels);
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	if (radius == 0) {
+		std::memcpy(dst, src, pixelCount * channels);
+		return;
+	}
+	for (int c = planes; c < channels; ++c) {
+		for (size_t i = 0; i < pixelCount; ++i) dst[i * channels + c] = src[i * channels + c];
+	}
+
+	const int size = 2 * radius + 1;
+	const int count = size * size;
+	const float clamped = std::min(std::max(percentile, 0.0f), 100.0f);
+	const int rank = static_cast<int>(std::lround(clamped / 100.0f * (count - 1)));
+	const bool network = radius <= 2 && 2 * rank == count - 1;
+	// Every histogram strip first adds 2 * radius + 1 rows, so strips grow
+	// with the radius to keep that setup small next to the rows they slide.
+	const int stripRows = network ? StripRows : std::max(StripRows, 8 * radius);
+	const int strips = (height + stripRows - 1) / stripRows;
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> ring, out;
+		ColumnHistograms histograms;
+		if (!network) {
+			histograms.columnOf.resize(static_cast<size_t>(width) + 2 * radius);
+			for (int x = -radius; x < width + radius; ++x) {
+				histograms.columnOf[x + radius] = (x >= 0 && x < width) ? x : borderCoordinate(x, width, border);
+			}
+			std::fill(histograms.zeroFine, histograms.zeroFine + Bins, static_cast<unsigned short>(0));
+			std::fill(histograms.zeroCoarse, histograms.zeroCoarse + CoarseBins, static_cast<unsigned short>(0));
+			histograms.zeroFine[0] = static_cast<unsigned short>(size);
+			histograms.zeroCoarse[0] = static_cast<unsigned short>(size);
+		}
+
+#pragma omp for schedule(dynamic)
+		for (int s = 0; s < strips; ++s) {
+			const int y0 = s * stripRows;
+			const int y1 = std::min(y0 + stripRows, height);
+			for (int c = 0; c < planes; ++c) {
+				if (network) {
+					medianStrip(src, dst, width, height, channels, c, y0, y1, radius, border, ring, out);
+				}
+				else {
+					histogramStrip(src, dst, width, height, channels, c, y0, y1, radius, rank, border, histograms, out);
+				}
+			}
+		}
+	}
+}
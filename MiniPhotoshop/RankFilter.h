@@ -0,0 +1,20 @@
+#ifndef RANK_FILTER_H
+#define RANK_FILTER_H
+
+#include "Stencil3x3.h"
+
+// Window counts are 16-bit, which bounds (2 radius + 1)^2.
+const int MaxRankRadius = 127;
+
+// Value at `percentile` of the sorted (2 radius + 1)^2 window around each
+// pixel: 0 is the minimum, 50 the median and 100 the maximum. Samples
+// outside the image follow the border mode, BorderMode::Zero counts them as
+// zeros. 3x3 and 5x5 medians run through the dispatched sorting networks,
+// everything else through per-column histograms (Perreault-Hebert), whose
+// cost per pixel does not depend on the radius. The first `planes` channels
+// are filtered and the rest copied; row strips run in parallel. The radius
+// is clamped to 0 .. MaxRankRadius.
+void rankFilter(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    int radius, float percentile, BorderMode border);
+
+#endif // RANK_FILTER_H
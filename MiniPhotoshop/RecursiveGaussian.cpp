@@ -0,0 +1,188 @@
+#include "RecursiveGaussian.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	// Rows filtered together by the horizontal pass and columns filtered
+	// together by the vertical pass. Each becomes ColorChannels float lanes.
+	const int RowBlock = 8;
+	const int ColumnBlock = 32;
+	const int ColorChannels = 3;
+
+	// y[n] = b * x[n] + a1 * y[n - 1] + a2 * y[n - 2] + a3 * y[n - 3]
+	struct Coefficients {
+		double b;
+		double a1, a2, a3;
+		// Triggs-Sdika matrix: anti-causal start state from the last three
+		// causal outputs, for a constant continuation of the input.
+		double m[9];
+	};
+
+	Coefficients coefficients(double sigma) {
+		const double q = sigma >= 2.5
+			? 0.98711 * sigma - 0.96330
+			: 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+		const double q2 = q * q, q3 = q2 * q;
+		const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+		const double a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+		const double a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+		const double a3 = 0.422205 * q3 / b0;
+
+		Coefficients c;
+		c.b = 1.0 - (a1 + a2 + a3);
+		c.a1 = a1;
+		c.a2 = a2;
+		c.a3 = a3;
+
+		const double scale = 1.0 / ((1.0 + a1 - a2 + a3) * (1.0 - a1 - a2 - a3) * (1.0 + a2 + (a1 - a3) * a3));
+		const double m[9] = {
+			-a3 * a1 + 1.0 - a3 * a3 - a2,
+			(a3 + a1) * (a2 + a3 * a1),
+			a3 * (a1 + a3 * a2),
+			a1 + a3 * a2,
+			-(a2 - 1.0) * (a2 + a3 * a1),
+			-a3 * (a3 * a1 + a3 * a3 + a2 - 1.0),
+			a3 * a1 + a2 + a1 * a1 - a2 * a2,
+			a1 * a2 + a3 * a2 * a2 - a1 * a3 * a3 - a3 * a3 * a3 - a3 * a2 + a3,
+			a3 * (a1 + a3 * a2)
+		};
+		for (int i = 0; i < 9; ++i) {
+			c.m[i] = m[i] * scale;
+		}
+		return c;
+	}
+
+	// Filters `lanes` independent signals of `length` samples stored as
+	// buffer[n * lanes + lane]. Every loop runs across the lanes, so the
+	// recursion itself never blocks vectorization. The feedback state is kept
+	// in double, with poles this close to 1 float recursion drifts by several
+	// levels at large sigmas; the buffer only holds filter inputs and outputs,
+	// so it stays float. `state` is scratch space for 4 * lanes doubles.
+	void filterLanes(float* buffer, int length, int lanes, const Coefficients& c, double* state) {
+		const double b = c.b, a1 = c.a1, a2 = c.a2, a3 = c.a3;
+		const size_t rowSize = static_cast<size_t>(lanes);
+		double* s1 = state;
+		double* s2 = s1 + rowSize;
+		double* s3 = s2 + rowSize;
+		double* last = s3 + rowSize;
+
+		// Causal pass. Before the first sample the output is in its steady
+		// state, which for a constant input equals the input.
+		for (int l = 0; l < lanes; ++l) {
+			s1[l] = s2[l] = s3[l] = buffer[l];
+			last[l] = buffer[(length - 1) * rowSize + l];
+		}
+		for (int n = 0; n < length; ++n) {
+			float* current = buffer + n * rowSize;
+			for (int l = 0; l < lanes; ++l) {
+				const double value = b * current[l] + a1 * s1[l] + a2 * s2[l] + a3 * s3[l];
+				current[l] = static_cast<float>(value);
+				s3[l] = value;
+			}
+			std::swap(s2, s3);
+			std::swap(s1, s2);
+		}
+
+		// Anti-causal start: y[N - 1], y[N] and y[N + 1] from the causal tail.
+		for (int l = 0; l < lanes; ++l) {
+			const double u0 = s1[l] - last[l], u1 = s2[l] - last[l], u2 = s3[l] - last[l];
+			s1[l] = b * (c.m[0] * u0 + c.m[1] * u1 + c.m[2] * u2) + last[l];
+			s2[l] = b * (c.m[3] * u0 + c.m[4] * u1 + c.m[5] * u2) + last[l];
+			s3[l] = b * (c.m[6] * u0 + c.m[7] * u1 + c.m[8] * u2) + last[l];
+			buffer[(length - 1) * rowSize + l] = static_cast<float>(s1[l]);
+		}
+		for (int n = length - 2; n >= 0; --n) {
+			float* current = buffer + n * rowSize;
+			for (int l = 0; l < lanes; ++l) {
+				const double value = b * current[l] + a1 * s1[l] + a2 * s2[l] + a3 * s3[l];
+				current[l] = static_cast<float>(value);
+				s3[l] = value;
+			}
+			std::swap(s2, s3);
+			std::swap(s1, s2);
+		}
+	}
+
+	unsigned char toByte(float value) {
+		return static_cast<unsigned char>(std::min(std::max(value + 0.5f, 0.0f), 255.0f));
+	}
+
+}
+
+void recursiveGaussian(unsigned char* data, int width, int height, int channels, float sigma) {
+	if (!data || width <= 0 || height <= 0 || sigma < 0.5f) return;
+
+	const Coefficients c = coefficients(sigma);
+	const size_t stride = static_cast<size_t>(width) * channels;
+
+	// Horizontal: RowBlock rows are transposed so that x becomes the sample
+	// index and (row, channel) the lane. The result is rounded back to
+	// 8 bits, which adds at most half a level of error before the vertical pass.
+	const int rowBlocks = (height + RowBlock - 1) / RowBlock;
+#pragma omp parallel
+	{
+		std::vector<float> buffer(static_cast<size_t>(width) * RowBlock * ColorChannels);
+		std::vector<double> state(4 * RowBlock * ColorChannels);
+#pragma omp for schedule(dynamic)
+		for (int block = 0; block < rowBlocks; ++block) {
+			const int y0 = block * RowBlock;
+			const int rows = std::min(RowBlock, height - y0);
+			const int lanes = rows * ColorChannels;
+			for (int x = 0; x < width; ++x) {
+				float* sample = buffer.data() + static_cast<size_t>(x) * lanes;
+				for (int r = 0; r < rows; ++r) {
+					const unsigned char* p = data + (y0 + r) * stride + static_cast<size_t>(x) * channels;
+					for (int ch = 0; ch < ColorChannels; ++ch) {
+						sample[r * ColorChannels + ch] = p[ch];
+					}
+				}
+			}
+			filterLanes(buffer.data(), width, lanes, c, state.data());
+			for (int x = 0; x < width; ++x) {
+				const float* sample = buffer.data() + static_cast<size_t>(x) * lanes;
+				for (int r = 0; r < rows; ++r) {
+					unsigned char* p = data + (y0 + r) * stride + static_cast<size_t>(x) * channels;
+					for (int ch = 0; ch < ColorChannels; ++ch) {
+						p[ch] = toByte(sample[r * ColorChannels + ch]);
+					}
+				}
+			}
+		}
+	}
+
+	// Vertical: ColumnBlock neighbouring columns are already contiguous in
+	// every row, so a column strip is copied as is and y is the sample index.
+	const int columnBlocks = (width + ColumnBlock - 1) / ColumnBlock;
+#pragma omp parallel
+	{
+		std::vector<float> buffer(static_cast<size_t>(height) * ColumnBlock * ColorChannels);
+		std::vector<double> state(4 * ColumnBlock * ColorChannels);
+#pragma omp for schedule(dynamic)
+		for (int block = 0; block < columnBlocks; ++block) {
+			const int x0 = block * ColumnBlock;
+			const int columns = std::min(ColumnBlock, width - x0);
+			const int lanes = columns * ColorChannels;
+			for (int y = 0; y < height; ++y) {
+				const unsigned char* p = data + y * stride + static_cast<size_t>(x0) * channels;
+				float* sample = buffer.data() + static_cast<size_t>(y) * lanes;
+				for (int i = 0; i < columns; ++i) {
+					for (int ch = 0; ch < ColorChannels; ++ch) {
+						sample[i * ColorChannels + ch] = p[i * channels + ch];
+					}
+				}
+			}
+			filterLanes(buffer.data(), height, lanes, c, state.data());
+			for (int y = 0; y < height; ++y) {
+				unsigned char* p = data + y * stride + static_cast<size_t>(x0) * channels;
+				const float* sample = buffer.data() + static_cast<size_t>(y) * lanes;
+				for (int i = 0; i < columns; ++i) {
+					for (int ch = 0; ch < ColorChannels; ++ch) {
+						p[i * channels + ch] = toByte(sample[i * ColorChannels + ch]);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,12 @@
+#ifndef RECURSIVE_GAUSSIAN_H
+#define RECURSIVE_GAUSSIAN_H
+
+// Young-van Vliet recursive Gaussian: a causal and an anti-causal third
+// order IIR pass per direction, so the cost per pixel does not depend on
+// sigma. Borders are replicated (Triggs-Sdika initialization of the
+// anti-causal pass). Blurs the color channels of interleaved 8-bit pixels
+// in place; alpha is left untouched. Sigmas below 0.5 leave the image
+// unchanged.
+void recursiveGaussian(unsigned char* data, int width, int height, int channels, float sigma);
+
+#endif // RECURSIVE_GAUSSIAN_H
@@ -0,0 +1,165 @@
+#include "Resize.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+	// Fixed-point weights sum to 1 << WeightBits, see resampleRow.
+	const int WeightBits = 14;
+	const double Pi = 3.14159265358979323846;
+
+	// Source window of every output pixel along one axis: taps consecutive
+	// source pixels from starts[i], weighted by weights[i * taps ...].
+	struct Coefficients {
+		int taps{ 0 };
+		std::vector<int> starts;
+		std::vector<short> weights;
+	};
+
+	double filterRadius(ResizeFilter filter) {
+		switch (filter) {
+		case ResizeFilter::Bicubic: return 2.0;
+		case ResizeFilter::Lanczos3: return 3.0;
+		default: return 1.0;
+		}
+	}
+
+	double sinc(double x) {
+		if (x == 0.0) return 1.0;
+		x *= Pi;
+		return std::sin(x) / x;
+	}
+
+	double filterWeight(ResizeFilter filter, double x) {
+		x = std::abs(x);
+		switch (filter) {
+		case ResizeFilter::Bicubic:
+			if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+			if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+			return 0.0;
+		case ResizeFilter::Lanczos3:
+			return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+		default:
+			return std::max(1.0 - x, 0.0);
+		}
+	}
+
+	Coefficients buildCoefficients(int srcSize, int dstSize, ResizeFilter filter) {
+		const double scale = static_cast<double>(srcSize) / dstSize;
+		const bool area = filter == ResizeFilter::Area;
+		const double stretch = std::max(scale, 1.0);
+		const double reach = filterRadius(filter) * stretch;
+
+		Coefficients coefficients;
+		const int span = area ? static_cast<int>(std::ceil(scale)) + 1 : static_cast<int>(std::ceil(2.0 * reach)) + 1;
+		// An even count lets the kernels apply the taps in pairs.
+		coefficients.taps = std::min(span + span % 2, srcSize);
+		const int taps = coefficients.taps;
+		coefficients.starts.resize(dstSize);
+		coefficients.weights.assign(static_cast<size_t>(dstSize) * taps, 0);
+
+		std::vector<double> weights(taps);
+		for (int i = 0; i < dstSize; ++i) {
+			int first;
+			int last;
+			if (area) {
+				const double left = i * scale;
+				const double right = left + scale;
+				first = std::max(static_cast<int>(std::floor(left)), 0);
+				last = std::min(static_cast<int>(std::ceil(right)), srcSize);
+				last = std::min(last, first + taps);
+				for (int j = first; j < last; ++j) {
+					weights[j - first] = std::max(std::min(j + 1.0, right) - std::max(static_cast<double>(j), left), 0.0);
+				}
+			}
+			else {
+				const double center = (i + 0.5) * scale;
+				first = std::max(static_cast<int>(std::floor(center - reach + 0.5)), 0);
+				last = std::min(std::min(static_cast<int>(std::ceil(center + reach + 0.5)), srcSize), first + taps);
+				for (int j = first; j < last; ++j) {
+					weights[j - first] = filterWeight(filter, (j + 0.5 - center) / stretch);
+				}
+			}
+
+			double total = 0.0;
+			for (int j = first; j < last; ++j) total += weights[j - first];
+			if (total == 0.0) {
+				// Nothing of the filter inside the image, take the nearest pixel.
+				first = std::min(std::max(static_cast<int>((i + 0.5) * scale), 0), srcSize - 1);
+				last = first + 1;
+				weights[0] = total = 1.0;
+			}
+
+			// The window is moved to fit into the image, the extra taps get 0.
+			const int start = std::min(first, srcSize - taps);
+			short* quantized = coefficients.weights.data() + static_cast<size_t>(i) * taps + (first - start);
+			int sum = 0;
+			int largest = 0;
+			for (int j = 0; j < last - first; ++j) {
+				quantized[j] = static_cast<short>(std::lround(weights[j] / total * (1 << WeightBits)));
+				sum += quantized[j];
+				if (std::abs(weights[j]) > std::abs(weights[largest])) largest = j;
+			}
+			// Rounding must not change the sum, or flat areas would shift.
+			quantized[largest] = static_cast<short>(quantized[largest] + (1 << WeightBits) - sum);
+			coefficients.starts[i] = start;
+		}
+		return coefficients;
+	}
+
+}
+
+const char* resizeFilterName(ResizeFilter filter) {
+	switch (filter) {
+	case ResizeFilter::Area: return "Area";
+	case ResizeFilter::Bilinear: return "Bilinear";
+	case ResizeFilter::Bicubic: return "Bicubic";
+	case ResizeFilter::Lanczos3: return "Lanczos-3";
+	default: return "Unknown";
+	}
+}
+
+void resizeImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+	unsigned char* dst, int dstWidth, int dstHeight, ResizeFilter filter) {
+	if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+
+	const Coefficients columns = buildCoefficients(srcWidth, dstWidth, filter);
+	const Coefficients rows = buildCoefficients(srcHeight, dstHeight, filter);
+	const KernelTable& table = kernels();
+	const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+	const size_t dstStride = static_cast<size_t>(dstWidth) * channels;
+	const int strips = (dstHeight + StripRows - 1) / StripRows;
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> buffer;
+		std::vector<const unsigned char*> window(rows.taps);
+
+#pragma omp for schedule(dynamic)
+		for (int s = 0; s < strips; ++s) {
+			const int y0 = s * StripRows;
+			const int y1 = std::min(y0 + StripRows, dstHeight);
+			// Windows only move forward, so the strip needs the source rows
+			// from the first window start to the last window end.
+			const int first = rows.starts[y0];
+			const int last = rows.starts[y1 - 1] + rows.taps;
+			buffer.resize(static_cast<size_t>(last - first) * dstStride);
+
+			for (int y = first; y < last; ++y) {
+				table.resampleRow(src + static_cast<size_t>(y) * srcStride, static_cast<size_t>(srcWidth),
+					columns.starts.data(), columns.weights.data(), columns.taps,
+					buffer.data() + static_cast<size_t>(y - first) * dstStride, static_cast<size_t>(dstWidth), static_cast<unsigned int>(channels));
+			}
+			for (int y = y0; y < y1; ++y) {
+				for (int t = 0; t < rows.taps; ++t) {
+					window[t] = buffer.data() + static_cast<size_t>(rows.starts[y] + t - first) * dstStride;
+				}
+				table.resampleColumns(window.data(), rows.weights.data() + static_cast<size_t>(y) * rows.taps, rows.taps,
+					dst + static_cast<size_t>(y) * dstStride, dstStride);
+			}
+		}
+	}
+}
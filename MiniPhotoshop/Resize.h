@@ -0,0 +1,30 @@
+#ifndef RESIZE_H
+#define RESIZE_H
+
+enum class ResizeFilter {
+    // Every output pixel is the mean of the source area it covers, the
+    // cleanest choice for downscaling.
+    Area = 0,
+    Bilinear,
+    // Keys cubic with a = -0.5.
+    Bicubic,
+    // sinc(x) sinc(x / 3) over 3 lobes, the sharpest of the four.
+    Lanczos3,
+    Count
+};
+
+const char* resizeFilterName(ResizeFilter filter);
+
+// Resamples interleaved 8-bit pixels to dstWidth x dstHeight, all channels
+// alike. The filter is separable: per output column and per output row the
+// source window and its weights are computed once, in 14-bit fixed point.
+// When downscaling the filter is stretched by the scale, so it averages every
+// source pixel instead of skipping some. Rows of the output are built in
+// strips that run in parallel: the horizontal pass resamples the source rows a
+// strip needs into a buffer, the vertical pass combines them, both through
+// the dispatched SIMD kernels. Windows are clipped to the image and
+// renormalized.
+void resizeImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+    unsigned char* dst, int dstWidth, int dstHeight, ResizeFilter filter);
+
+#endif // RESIZE_H
@@ -0,0 +1,126 @@
+#ifndef SIMD_COMMON_H
+#define SIMD_COMMON_H
+
+// Shared SSE4.1 helpers for the vector kernel translation units. Include this
+// only after the unit has selected its target instruction set, every unit
+// gets its own internal copy compiled for that set. Standard headers and
+// SimdScalar.h have to come before the target switch.
+
+#include <immintrin.h>
+
+namespace {
+
+	struct StencilTap {
+		int row;
+		int offset;
+		short weight;
+	};
+
+	// Non-zero taps of a 3x3 stencil, so the vector loops skip the zeros.
+	int collectTaps(const short weights[9], StencilTap taps[9]) {
+		int count = 0;
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				if (weights[r * 3 + c] != 0) {
+					taps[count++] = { r, c - 1, weights[r * 3 + c] };
+				}
+			}
+		}
+		return count;
+	}
+
+	// Byte shuffle that gathers channel `channel` of 16 packed RGB pixels out of
+	// the `part`-th 16-byte slice of the 48-byte group.
+	__m128i rgbGatherMask(int channel, int part) {
+		alignas(16) char mask[16];
+		for (int i = 0; i < 16; ++i) {
+			const int src = i * 3 + channel;
+			mask[i] = (src / 16 == part) ? static_cast<char>(src % 16) : static_cast<char>(0x80);
+		}
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+	}
+
+	struct Planes16 {
+		__m128i r, g, b;
+	};
+
+	class Deinterleaver {
+	public:
+		explicit Deinterleaver(unsigned int channels) : channels(channels) {
+			for (int c = 0; c < 3; ++c) {
+				for (int p = 0; p < 3; ++p) {
+					rgbMasks[c][p] = rgbGatherMask(c, p);
+				}
+			}
+			rgbaMask = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+		}
+
+		Planes16 load(const unsigned char* src) const {
+			Planes16 out;
+			if (channels == 4) {
+				__m128i t0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), rgbaMask);
+				__m128i t1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), rgbaMask);
+				__m128i t2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32)), rgbaMask);
+				__m128i t3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48)), rgbaMask);
+				__m128i rg01 = _mm_unpacklo_epi32(t0, t1);
+				__m128i rg23 = _mm_unpacklo_epi32(t2, t3);
+				__m128i ba01 = _mm_unpackhi_epi32(t0, t1);
+				__m128i ba23 = _mm_unpackhi_epi32(t2, t3);
+				out.r = _mm_unpacklo_epi64(rg01, rg23);
+				out.g = _mm_unpackhi_epi64(rg01, rg23);
+				out.b = _mm_unpacklo_epi64(ba01, ba23);
+			}
+			else {
+				__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+				__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+				__m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+				__m128i* planes[3] = { &out.r, &out.g, &out.b };
+				for (int c = 0; c < 3; ++c) {
+					*planes[c] = _mm_or_si128(
+						_mm_or_si128(_mm_shuffle_epi8(v0, rgbMasks[c][0]), _mm_shuffle_epi8(v1, rgbMasks[c][1])),
+						_mm_shuffle_epi8(v2, rgbMasks[c][2]));
+				}
+			}
+			return out;
+		}
+
+	private:
+		unsigned int channels;
+		__m128i rgbMasks[3][3];
+		__m128i rgbaMask;
+	};
+
+	// Spreads one int16 value per pixel over the color bytes of 16 interleaved
+	// pixels, 8 bytes at a time: group g covers bytes 8g .. 8g + 7 of the
+	// 48 (RGB) or 64 (RGBA) byte block. Alpha bytes receive 0.
+	class PixelSpreader {
+	public:
+		explicit PixelSpreader(unsigned int channels) : groups(static_cast<int>(channels) * 2) {
+			for (int g = 0; g < groups; ++g) {
+				alignas(16) char mask[16];
+				for (int j = 0; j < 8; ++j) {
+					const int byte = g * 8 + j;
+					const int pixel = byte / static_cast<int>(channels) - (g >= groups / 2 ? 8 : 0);
+					const bool color = byte % static_cast<int>(channels) < 3;
+					mask[2 * j] = color ? static_cast<char>(2 * pixel) : static_cast<char>(0x80);
+					mask[2 * j + 1] = color ? static_cast<char>(2 * pixel + 1) : static_cast<char>(0x80);
+				}
+				masks[g] = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+			}
+		}
+
+		int groupCount() const { return groups; }
+
+		// lo holds the values of pixels 0-7, hi those of pixels 8-15.
+		__m128i spread(int group, __m128i lo, __m128i hi) const {
+			return _mm_shuffle_epi8(group < groups / 2 ? lo : hi, masks[group]);
+		}
+
+	private:
+		int groups;
+		__m128i masks[8];
+	};
+
+}
+
+#endif // SIMD_COMMON_H
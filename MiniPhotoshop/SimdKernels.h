@@ -0,0 +1,18 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include "CpuDispatch.h"
+
+// Each translation unit is compiled for one instruction set and overwrites
+// the table entries it has a faster implementation for. The scalar variant
+// fills every entry, so a newer kernel without a vector path still works.
+namespace simd {
+    void installScalar(KernelTable& table);
+#ifdef MINIPHOTOSHOP_X86
+    void installSse41(KernelTable& table);
+    void installAvx2(KernelTable& table);
+    void installAvx512bw(KernelTable& table);
+#endif
+}
+
+#endif // SIMD_KERNELS_H
@@ -0,0 +1,242 @@
+#include "SimdKernels.h"
+#include "SimdScalar.h"
+
+#ifdef MINIPHOTOSHOP_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include "MedianNetwork.h"
+#include "SimdCommon.h"
+
+namespace {
+
+	__m256i lumaEpi16(__m128i r, __m128i g, __m128i b) {
+		__m256i y = _mm256_add_epi16(
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(r), _mm256_set1_epi16(77)),
+			_mm256_mullo_epi16(_mm256_cvtepu8_epi16(g), _mm256_set1_epi16(150)));
+		y = _mm256_add_epi16(y, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(b), _mm256_set1_epi16(29)));
+		return _mm256_srli_epi16(_mm256_add_epi16(y, _mm256_set1_epi16(128)), 8);
+	}
+
+	void rgbToLuma(const unsigned char* src, unsigned char* dst, size_t pixelCount, unsigned int channels) {
+		const Deinterleaver deinterleaver(channels);
+		size_t i = 0;
+		for (; i + 32 <= pixelCount; i += 32) {
+			Planes16 p0 = deinterleaver.load(src + i * channels);
+			Planes16 p1 = deinterleaver.load(src + (i + 16) * channels);
+			__m256i y0 = lumaEpi16(p0.r, p0.g, p0.b);
+			__m256i y1 = lumaEpi16(p1.r, p1.g, p1.b);
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+		}
+		for (; i < pixelCount; ++i) {
+			dst[i] = lumaOf(src + i * channels);
+		}
+	}
+
+	void invertColor(unsigned char* data, size_t pixelCount, unsigned int channels) {
+		const size_t byteCount = pixelCount * channels;
+		const __m256i mask = channels == 4 ? _mm256_set1_epi32(0x00FFFFFF) : _mm256_set1_epi8(-1);
+		size_t i = 0;
+		for (; i + 32 <= byteCount; i += 32) {
+			__m256i* p = reinterpret_cast<__m256i*>(data + i);
+			_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+		}
+		for (; i < byteCount; ++i) {
+			if (channels != 4 || i % 4 != 3) {
+				data[i] = 255 - data[i];
+			}
+		}
+	}
+
+	__m256i loadWiden(const unsigned char* p) {
+		return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	void stencil3x3Row(const unsigned char* const rows[3], const short weights[9], short* dst, size_t count) {
+		StencilTap taps[9];
+		const int tapCount = collectTaps(weights, taps);
+		__m256i tapWeights[9];
+		for (int t = 0; t < tapCount; ++t) {
+			tapWeights[t] = _mm256_set1_epi16(taps[t].weight);
+		}
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m256i sum = _mm256_setzero_si256();
+			for (int t = 0; t < tapCount; ++t) {
+				const __m256i pixels = loadWiden(rows[taps[t].row] + i + taps[t].offset);
+				sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(pixels, tapWeights[t]));
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+		}
+		for (; i < count; ++i) {
+			dst[i] = stencilAt(rows, weights, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void gradient3x3Row(const unsigned char* const rows[3], int center, short* gx, short* gy, size_t count) {
+		const __m256i centerWeight = _mm256_set1_epi16(static_cast<short>(center));
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			const unsigned char* above = rows[0] + i;
+			const unsigned char* row = rows[1] + i;
+			const unsigned char* below = rows[2] + i;
+			const __m256i a0 = loadWiden(above - 1), a1 = loadWiden(above), a2 = loadWiden(above + 1);
+			const __m256i r0 = loadWiden(row - 1), r2 = loadWiden(row + 1);
+			const __m256i b0 = loadWiden(below - 1), b1 = loadWiden(below), b2 = loadWiden(below + 1);
+
+			const __m256i x = _mm256_add_epi16(
+				_mm256_add_epi16(_mm256_sub_epi16(a2, a0), _mm256_sub_epi16(b2, b0)),
+				_mm256_mullo_epi16(_mm256_sub_epi16(r2, r0), centerWeight));
+			const __m256i y = _mm256_add_epi16(
+				_mm256_add_epi16(_mm256_sub_epi16(b0, a0), _mm256_sub_epi16(b2, a2)),
+				_mm256_mullo_epi16(_mm256_sub_epi16(b1, a1), centerWeight));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(gx + i), x);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(gy + i), y);
+		}
+		for (; i < count; ++i) {
+			gradientAt(rows, center, static_cast<std::ptrdiff_t>(i), gx[i], gy[i]);
+		}
+	}
+
+	void gradientMagnitude(const short* gx, const short* gy, float* magnitude, size_t count) {
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gx + i));
+			const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gy + i));
+			// unpack works per 128-bit lane: lo holds pixels 0-3 and 8-11, hi 4-7 and 12-15.
+			const __m256i lo = _mm256_unpacklo_epi16(x, y);
+			const __m256i hi = _mm256_unpackhi_epi16(x, y);
+			const __m256 magLo = _mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(lo, lo)));
+			const __m256 magHi = _mm256_sqrt_ps(_mm256_cvtepi32_ps(_mm256_madd_epi16(hi, hi)));
+			_mm256_storeu_ps(magnitude + i, _mm256_permute2f128_ps(magLo, magHi, 0x20));
+			_mm256_storeu_ps(magnitude + i + 8, _mm256_permute2f128_ps(magLo, magHi, 0x31));
+		}
+		for (; i < count; ++i) {
+			magnitude[i] = magnitudeOf(gx[i], gy[i]);
+		}
+	}
+
+	struct SortEpu8 {
+		void operator()(__m256i& a, __m256i& b) const {
+			const __m256i low = _mm256_min_epu8(a, b);
+			b = _mm256_max_epu8(a, b);
+			a = low;
+		}
+	};
+
+	void medianRow(const unsigned char* const* rows, int size, unsigned char* dst, size_t count) {
+		const int half = size / 2;
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32) {
+			__m256i p[25];
+			for (int r = 0; r < size; ++r) {
+				for (int c = 0; c < size; ++c) {
+					p[r * size + c] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[r] + i + c - half));
+				}
+			}
+			const __m256i median = size == 3 ? median9(p, SortEpu8()) : median25(p, SortEpu8());
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), median);
+		}
+		for (; i < count; ++i) {
+			dst[i] = medianAt(rows, size, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	// Same operations as exponentialDecay in SimdScalar.h.
+	__m256 exponentialDecay(__m256 t) {
+		const __m256 y = _mm256_min_ps(_mm256_mul_ps(t, _mm256_set1_ps(1.44269504f)), _mm256_set1_ps(126.0f));
+		const __m256 k = _mm256_floor_ps(y);
+		const __m256 f = _mm256_sub_ps(y, k);
+		__m256 p = _mm256_mul_ps(f, _mm256_set1_ps(-0.00133335581f));
+		p = _mm256_mul_ps(f, _mm256_add_ps(_mm256_set1_ps(0.00961812911f), p));
+		p = _mm256_mul_ps(f, _mm256_add_ps(_mm256_set1_ps(-0.0555041087f), p));
+		p = _mm256_mul_ps(f, _mm256_add_ps(_mm256_set1_ps(0.240226507f), p));
+		p = _mm256_mul_ps(f, _mm256_add_ps(_mm256_set1_ps(-0.693147181f), p));
+		p = _mm256_add_ps(_mm256_set1_ps(1.0f), p);
+		const __m256i bits = _mm256_slli_epi32(_mm256_sub_epi32(_mm256_set1_epi32(127), _mm256_cvttps_epi32(k)), 23);
+		return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+	}
+
+	__m256 conductionOf(int conduction, __m256 t) {
+		if (conduction == 0) return exponentialDecay(t);
+		if (conduction == 1) return _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_add_ps(_mm256_set1_ps(1.0f), t));
+		const __m256 u = _mm256_max_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), t), _mm256_setzero_ps());
+		return _mm256_mul_ps(u, u);
+	}
+
+	void diffusionRow(const float* above, const float* row, const float* below, float* dst, size_t count,
+		int conduction, float inverseKappaSquared, float lambda) {
+		const __m256 scale = _mm256_set1_ps(inverseKappaSquared);
+		auto conducted = [&](__m256 d) {
+			return _mm256_mul_ps(conductionOf(conduction, _mm256_mul_ps(_mm256_mul_ps(d, d), scale)), d);
+		};
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			const __m256 c = _mm256_loadu_ps(row + i);
+			__m256 flux = conducted(_mm256_sub_ps(_mm256_loadu_ps(above + i), c));
+			flux = _mm256_add_ps(flux, conducted(_mm256_sub_ps(_mm256_loadu_ps(below + i), c)));
+			flux = _mm256_add_ps(flux, conducted(_mm256_sub_ps(_mm256_loadu_ps(row + i + 1), c)));
+			flux = _mm256_add_ps(flux, conducted(_mm256_sub_ps(_mm256_loadu_ps(row + i - 1), c)));
+			_mm256_storeu_ps(dst + i, _mm256_add_ps(c, _mm256_mul_ps(_mm256_set1_ps(lambda), flux)));
+		}
+		for (; i < count; ++i) {
+			dst[i] = diffusionAt(above, row, below, conduction, inverseKappaSquared, lambda, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void resampleColumns(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, size_t count) {
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i half = _mm256_set1_epi32(1 << 13);
+		size_t i = 0;
+		// The unpacks work within 128-bit lanes and so do the packs, which
+		// puts every byte back in place.
+		for (; i + 32 <= count; i += 32) {
+			__m256i s0 = half;
+			__m256i s1 = half;
+			__m256i s2 = half;
+			__m256i s3 = half;
+			for (int t = 0; t < taps; t += 2) {
+				const bool pair = t + 1 < taps;
+				const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t] + i));
+				const __m256i b = pair ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[t + 1] + i)) : zero;
+				const __m256i weight = _mm256_unpacklo_epi16(_mm256_set1_epi16(weights[t]), _mm256_set1_epi16(pair ? weights[t + 1] : 0));
+				const __m256i lo = _mm256_unpacklo_epi8(a, b);
+				const __m256i hi = _mm256_unpackhi_epi8(a, b);
+				s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), weight));
+				s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), weight));
+				s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), weight));
+				s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), weight));
+			}
+			const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(s0, 14), _mm256_srai_epi32(s1, 14));
+			const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(s2, 14), _mm256_srai_epi32(s3, 14));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+		}
+		for (; i < count; ++i) {
+			dst[i] = resampleColumnAt(rows, weights, taps, i);
+		}
+	}
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+void simd::installAvx2(KernelTable& table) {
+	table.rgbToLuma = rgbToLuma;
+	table.invertColor = invertColor;
+	table.stencil3x3Row = stencil3x3Row;
+	table.gradient3x3Row = gradient3x3Row;
+	table.gradientMagnitude = gradientMagnitude;
+	table.medianRow = medianRow;
+	table.diffusionRow = diffusionRow;
+	table.resampleColumns = resampleColumns;
+}
+
+#endif // MINIPHOTOSHOP_X86
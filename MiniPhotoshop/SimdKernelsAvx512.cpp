@@ -0,0 +1,130 @@
+#include "SimdKernels.h"
+#include "SimdScalar.h"
+
+#ifdef MINIPHOTOSHOP_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("avx512f,avx512bw")
+#endif
+
+#include "SimdCommon.h"
+
+namespace {
+
+	__m512i widen(__m128i lo, __m128i hi) {
+		return _mm512_cvtepu8_epi16(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1));
+	}
+
+	void rgbToLuma(const unsigned char* src, unsigned char* dst, size_t pixelCount, unsigned int channels) {
+		const Deinterleaver deinterleaver(channels);
+		size_t i = 0;
+		for (; i + 32 <= pixelCount; i += 32) {
+			Planes16 p0 = deinterleaver.load(src + i * channels);
+			Planes16 p1 = deinterleaver.load(src + (i + 16) * channels);
+			__m512i y = _mm512_add_epi16(
+				_mm512_mullo_epi16(widen(p0.r, p1.r), _mm512_set1_epi16(77)),
+				_mm512_mullo_epi16(widen(p0.g, p1.g), _mm512_set1_epi16(150)));
+			y = _mm512_add_epi16(y, _mm512_mullo_epi16(widen(p0.b, p1.b), _mm512_set1_epi16(29)));
+			y = _mm512_srli_epi16(_mm512_add_epi16(y, _mm512_set1_epi16(128)), 8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm512_cvtepi16_epi8(y));
+		}
+		for (; i < pixelCount; ++i) {
+			dst[i] = lumaOf(src + i * channels);
+		}
+	}
+
+	void invertColor(unsigned char* data, size_t pixelCount, unsigned int channels) {
+		const size_t byteCount = pixelCount * channels;
+		const __m512i mask = channels == 4 ? _mm512_set1_epi32(0x00FFFFFF) : _mm512_set1_epi8(-1);
+		size_t i = 0;
+		for (; i + 64 <= byteCount; i += 64) {
+			_mm512_storeu_si512(data + i, _mm512_xor_si512(_mm512_loadu_si512(data + i), mask));
+		}
+		for (; i < byteCount; ++i) {
+			if (channels != 4 || i % 4 != 3) {
+				data[i] = 255 - data[i];
+			}
+		}
+	}
+
+	__m512i loadWiden(const unsigned char* p) {
+		return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+	}
+
+	void stencil3x3Row(const unsigned char* const rows[3], const short weights[9], short* dst, size_t count) {
+		StencilTap taps[9];
+		const int tapCount = collectTaps(weights, taps);
+		__m512i tapWeights[9];
+		for (int t = 0; t < tapCount; ++t) {
+			tapWeights[t] = _mm512_set1_epi16(taps[t].weight);
+		}
+
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32) {
+			__m512i sum = _mm512_setzero_si512();
+			for (int t = 0; t < tapCount; ++t) {
+				const __m512i pixels = loadWiden(rows[taps[t].row] + i + taps[t].offset);
+				sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(pixels, tapWeights[t]));
+			}
+			_mm512_storeu_si512(dst + i, sum);
+		}
+		for (; i < count; ++i) {
+			dst[i] = stencilAt(rows, weights, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void gradient3x3Row(const unsigned char* const rows[3], int center, short* gx, short* gy, size_t count) {
+		const __m512i centerWeight = _mm512_set1_epi16(static_cast<short>(center));
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32) {
+			const unsigned char* above = rows[0] + i;
+			const unsigned char* row = rows[1] + i;
+			const unsigned char* below = rows[2] + i;
+			const __m512i a0 = loadWiden(above - 1), a1 = loadWiden(above), a2 = loadWiden(above + 1);
+			const __m512i r0 = loadWiden(row - 1), r2 = loadWiden(row + 1);
+			const __m512i b0 = loadWiden(below - 1), b1 = loadWiden(below), b2 = loadWiden(below + 1);
+
+			const __m512i x = _mm512_add_epi16(
+				_mm512_add_epi16(_mm512_sub_epi16(a2, a0), _mm512_sub_epi16(b2, b0)),
+				_mm512_mullo_epi16(_mm512_sub_epi16(r2, r0), centerWeight));
+			const __m512i y = _mm512_add_epi16(
+				_mm512_add_epi16(_mm512_sub_epi16(b0, a0), _mm512_sub_epi16(b2, a2)),
+				_mm512_mullo_epi16(_mm512_sub_epi16(b1, a1), centerWeight));
+			_mm512_storeu_si512(gx + i, x);
+			_mm512_storeu_si512(gy + i, y);
+		}
+		for (; i < count; ++i) {
+			gradientAt(rows, center, static_cast<std::ptrdiff_t>(i), gx[i], gy[i]);
+		}
+	}
+
+	void gradientMagnitude(const short* gx, const short* gy, float* magnitude, size_t count) {
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			const __m512i x = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(gx + i)));
+			const __m512i y = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(gy + i)));
+			const __m512i squared = _mm512_add_epi32(_mm512_mullo_epi32(x, x), _mm512_mullo_epi32(y, y));
+			_mm512_storeu_ps(magnitude + i, _mm512_sqrt_ps(_mm512_cvtepi32_ps(squared)));
+		}
+		for (; i < count; ++i) {
+			magnitude[i] = magnitudeOf(gx[i], gy[i]);
+		}
+	}
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+void simd::installAvx512bw(KernelTable& table) {
+	table.rgbToLuma = rgbToLuma;
+	table.invertColor = invertColor;
+	table.stencil3x3Row = stencil3x3Row;
+	table.gradient3x3Row = gradient3x3Row;
+	table.gradientMagnitude = gradientMagnitude;
+}
+
+#endif // MINIPHOTOSHOP_X86
@@ -0,0 +1,85 @@
+#include "SimdKernels.h"
+#include "SimdScalar.h"
+#include "MedianNetwork.h"
+
+namespace {
+
+	void rgbToLuma(const unsigned char* src, unsigned char* dst, size_t pixelCount, unsigned int channels) {
+		for (size_t i = 0; i < pixelCount; ++i) {
+			dst[i] = lumaOf(src + i * channels);
+		}
+	}
+
+	void invertColor(unsigned char* data, size_t pixelCount, unsigned int channels) {
+		for (size_t i = 0; i < pixelCount; ++i) {
+			unsigned char* p = data + i * channels;
+			p[0] = 255 - p[0];
+			p[1] = 255 - p[1];
+			p[2] = 255 - p[2];
+		}
+	}
+
+	void replaceLuma(unsigned char* data, const unsigned char* luma, size_t pixelCount, unsigned int channels) {
+		for (size_t i = 0; i < pixelCount; ++i) {
+			replaceLumaAt(data + i * channels, luma[i]);
+		}
+	}
+
+	void stencil3x3Row(const unsigned char* const rows[3], const short weights[9], short* dst, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			dst[i] = stencilAt(rows, weights, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void gradient3x3Row(const unsigned char* const rows[3], int center, short* gx, short* gy, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			gradientAt(rows, center, static_cast<std::ptrdiff_t>(i), gx[i], gy[i]);
+		}
+	}
+
+	void gradientMagnitude(const short* gx, const short* gy, float* magnitude, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			magnitude[i] = magnitudeOf(gx[i], gy[i]);
+		}
+	}
+
+	void medianRow(const unsigned char* const* rows, int size, unsigned char* dst, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			dst[i] = medianAt(rows, size, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void diffusionRow(const float* above, const float* row, const float* below, float* dst, size_t count,
+		int conduction, float inverseKappaSquared, float lambda) {
+		for (size_t i = 0; i < count; ++i) {
+			dst[i] = diffusionAt(above, row, below, conduction, inverseKappaSquared, lambda, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void resampleRow(const unsigned char* src, size_t, const int* starts, const short* weights, int taps,
+		unsigned char* dst, size_t dstWidth, unsigned int channels) {
+		for (size_t x = 0; x < dstWidth; ++x) {
+			resampleAt(src, starts, weights, taps, dst, channels, x);
+		}
+	}
+
+	void resampleColumns(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			dst[i] = resampleColumnAt(rows, weights, taps, i);
+		}
+	}
+
+}
+
+void simd::installScalar(KernelTable& table) {
+	table.rgbToLuma = rgbToLuma;
+	table.invertColor = invertColor;
+	table.stencil3x3Row = stencil3x3Row;
+	table.gradient3x3Row = gradient3x3Row;
+	table.gradientMagnitude = gradientMagnitude;
+	table.replaceLuma = replaceLuma;
+	table.medianRow = medianRow;
+	table.diffusionRow = diffusionRow;
+	table.resampleRow = resampleRow;
+	table.resampleColumns = resampleColumns;
+}
@@ -0,0 +1,312 @@
+#include "SimdKernels.h"
+#include "SimdScalar.h"
+
+#ifdef MINIPHOTOSHOP_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse4.1"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC target("sse4.1")
+#endif
+
+#include "MedianNetwork.h"
+#include "SimdCommon.h"
+
+namespace {
+
+	__m128i lumaEpi16(__m128i r, __m128i g, __m128i b) {
+		__m128i y = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(77)), _mm_mullo_epi16(g, _mm_set1_epi16(150)));
+		y = _mm_add_epi16(y, _mm_mullo_epi16(b, _mm_set1_epi16(29)));
+		return _mm_srli_epi16(_mm_add_epi16(y, _mm_set1_epi16(128)), 8);
+	}
+
+	void rgbToLuma(const unsigned char* src, unsigned char* dst, size_t pixelCount, unsigned int channels) {
+		const Deinterleaver deinterleaver(channels);
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= pixelCount; i += 16) {
+			Planes16 p = deinterleaver.load(src + i * channels);
+			__m128i lo = lumaEpi16(_mm_cvtepu8_epi16(p.r), _mm_cvtepu8_epi16(p.g), _mm_cvtepu8_epi16(p.b));
+			__m128i hi = lumaEpi16(_mm_unpackhi_epi8(p.r, zero), _mm_unpackhi_epi8(p.g, zero), _mm_unpackhi_epi8(p.b, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+		}
+		for (; i < pixelCount; ++i) {
+			dst[i] = lumaOf(src + i * channels);
+		}
+	}
+
+	void invertColor(unsigned char* data, size_t pixelCount, unsigned int channels) {
+		const size_t byteCount = pixelCount * channels;
+		const __m128i mask = channels == 4 ? _mm_set1_epi32(0x00FFFFFF) : _mm_set1_epi8(-1);
+		size_t i = 0;
+		for (; i + 16 <= byteCount; i += 16) {
+			__m128i* p = reinterpret_cast<__m128i*>(data + i);
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), mask));
+		}
+		for (; i < byteCount; ++i) {
+			if (channels != 4 || i % 4 != 3) {
+				data[i] = 255 - data[i];
+			}
+		}
+	}
+
+	__m128i loadWiden(const unsigned char* p) {
+		return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+	}
+
+	void replaceLuma(unsigned char* data, const unsigned char* luma, size_t pixelCount, unsigned int channels) {
+		const Deinterleaver deinterleaver(channels);
+		const PixelSpreader spreader(channels);
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= pixelCount; i += 16) {
+			unsigned char* block = data + i * channels;
+			Planes16 p = deinterleaver.load(block);
+			const __m128i yLo = lumaEpi16(_mm_cvtepu8_epi16(p.r), _mm_cvtepu8_epi16(p.g), _mm_cvtepu8_epi16(p.b));
+			const __m128i yHi = lumaEpi16(_mm_unpackhi_epi8(p.r, zero), _mm_unpackhi_epi8(p.g, zero), _mm_unpackhi_epi8(p.b, zero));
+			const __m128i target = _mm_loadu_si128(reinterpret_cast<const __m128i*>(luma + i));
+			const __m128i deltaLo = _mm_sub_epi16(_mm_cvtepu8_epi16(target), yLo);
+			const __m128i deltaHi = _mm_sub_epi16(_mm_unpackhi_epi8(target, zero), yHi);
+
+			for (int g = 0; g < spreader.groupCount(); g += 2) {
+				const __m128i first = _mm_add_epi16(loadWiden(block + g * 8), spreader.spread(g, deltaLo, deltaHi));
+				const __m128i second = _mm_add_epi16(loadWiden(block + g * 8 + 8), spreader.spread(g + 1, deltaLo, deltaHi));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(block + g * 8), _mm_packus_epi16(first, second));
+			}
+		}
+		for (; i < pixelCount; ++i) {
+			replaceLumaAt(data + i * channels, luma[i]);
+		}
+	}
+
+	void stencil3x3Row(const unsigned char* const rows[3], const short weights[9], short* dst, size_t count) {
+		StencilTap taps[9];
+		const int tapCount = collectTaps(weights, taps);
+		__m128i tapWeights[9];
+		for (int t = 0; t < tapCount; ++t) {
+			tapWeights[t] = _mm_set1_epi16(taps[t].weight);
+		}
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			__m128i sum = _mm_setzero_si128();
+			for (int t = 0; t < tapCount; ++t) {
+				const __m128i pixels = loadWiden(rows[taps[t].row] + i + taps[t].offset);
+				sum = _mm_add_epi16(sum, _mm_mullo_epi16(pixels, tapWeights[t]));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), sum);
+		}
+		for (; i < count; ++i) {
+			dst[i] = stencilAt(rows, weights, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void gradient3x3Row(const unsigned char* const rows[3], int center, short* gx, short* gy, size_t count) {
+		const __m128i centerWeight = _mm_set1_epi16(static_cast<short>(center));
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			const unsigned char* above = rows[0] + i;
+			const unsigned char* row = rows[1] + i;
+			const unsigned char* below = rows[2] + i;
+			const __m128i a0 = loadWiden(above - 1), a1 = loadWiden(above), a2 = loadWiden(above + 1);
+			const __m128i r0 = loadWiden(row - 1), r2 = loadWiden(row + 1);
+			const __m128i b0 = loadWiden(below - 1), b1 = loadWiden(below), b2 = loadWiden(below + 1);
+
+			const __m128i x = _mm_add_epi16(
+				_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(b2, b0)),
+				_mm_mullo_epi16(_mm_sub_epi16(r2, r0), centerWeight));
+			const __m128i y = _mm_add_epi16(
+				_mm_add_epi16(_mm_sub_epi16(b0, a0), _mm_sub_epi16(b2, a2)),
+				_mm_mullo_epi16(_mm_sub_epi16(b1, a1), centerWeight));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(gx + i), x);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(gy + i), y);
+		}
+		for (; i < count; ++i) {
+			gradientAt(rows, center, static_cast<std::ptrdiff_t>(i), gx[i], gy[i]);
+		}
+	}
+
+	void gradientMagnitude(const short* gx, const short* gy, float* magnitude, size_t count) {
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8) {
+			const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gx + i));
+			const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gy + i));
+			const __m128i lo = _mm_unpacklo_epi16(x, y);
+			const __m128i hi = _mm_unpackhi_epi16(x, y);
+			_mm_storeu_ps(magnitude + i, _mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(lo, lo))));
+			_mm_storeu_ps(magnitude + i + 4, _mm_sqrt_ps(_mm_cvtepi32_ps(_mm_madd_epi16(hi, hi))));
+		}
+		for (; i < count; ++i) {
+			magnitude[i] = magnitudeOf(gx[i], gy[i]);
+		}
+	}
+
+	struct SortEpu8 {
+		void operator()(__m128i& a, __m128i& b) const {
+			const __m128i low = _mm_min_epu8(a, b);
+			b = _mm_max_epu8(a, b);
+			a = low;
+		}
+	};
+
+	void medianRow(const unsigned char* const* rows, int size, unsigned char* dst, size_t count) {
+		const int half = size / 2;
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i p[25];
+			for (int r = 0; r < size; ++r) {
+				for (int c = 0; c < size; ++c) {
+					p[r * size + c] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[r] + i + c - half));
+				}
+			}
+			const __m128i median = size == 3 ? median9(p, SortEpu8()) : median25(p, SortEpu8());
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), median);
+		}
+		for (; i < count; ++i) {
+			dst[i] = medianAt(rows, size, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	// Same operations as exponentialDecay in SimdScalar.h.
+	__m128 exponentialDecay(__m128 t) {
+		const __m128 y = _mm_min_ps(_mm_mul_ps(t, _mm_set1_ps(1.44269504f)), _mm_set1_ps(126.0f));
+		const __m128 k = _mm_floor_ps(y);
+		const __m128 f = _mm_sub_ps(y, k);
+		__m128 p = _mm_mul_ps(f, _mm_set1_ps(-0.00133335581f));
+		p = _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(0.00961812911f), p));
+		p = _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(-0.0555041087f), p));
+		p = _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(0.240226507f), p));
+		p = _mm_mul_ps(f, _mm_add_ps(_mm_set1_ps(-0.693147181f), p));
+		p = _mm_add_ps(_mm_set1_ps(1.0f), p);
+		const __m128i bits = _mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127), _mm_cvttps_epi32(k)), 23);
+		return _mm_mul_ps(p, _mm_castsi128_ps(bits));
+	}
+
+	__m128 conductionOf(int conduction, __m128 t) {
+		if (conduction == 0) return exponentialDecay(t);
+		if (conduction == 1) return _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), t));
+		const __m128 u = _mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), t), _mm_setzero_ps());
+		return _mm_mul_ps(u, u);
+	}
+
+	void diffusionRow(const float* above, const float* row, const float* below, float* dst, size_t count,
+		int conduction, float inverseKappaSquared, float lambda) {
+		const __m128 scale = _mm_set1_ps(inverseKappaSquared);
+		auto conducted = [&](__m128 d) {
+			return _mm_mul_ps(conductionOf(conduction, _mm_mul_ps(_mm_mul_ps(d, d), scale)), d);
+		};
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			const __m128 c = _mm_loadu_ps(row + i);
+			__m128 flux = conducted(_mm_sub_ps(_mm_loadu_ps(above + i), c));
+			flux = _mm_add_ps(flux, conducted(_mm_sub_ps(_mm_loadu_ps(below + i), c)));
+			flux = _mm_add_ps(flux, conducted(_mm_sub_ps(_mm_loadu_ps(row + i + 1), c)));
+			flux = _mm_add_ps(flux, conducted(_mm_sub_ps(_mm_loadu_ps(row + i - 1), c)));
+			_mm_storeu_ps(dst + i, _mm_add_ps(c, _mm_mul_ps(_mm_set1_ps(lambda), flux)));
+		}
+		for (; i < count; ++i) {
+			dst[i] = diffusionAt(above, row, below, conduction, inverseKappaSquared, lambda, static_cast<std::ptrdiff_t>(i));
+		}
+	}
+
+	void resampleRow(const unsigned char* src, size_t srcWidth, const int* starts, const short* weights, int taps,
+		unsigned char* dst, size_t dstWidth, unsigned int channels) {
+		if (channels != 3 && channels != 4) {
+			for (size_t x = 0; x < dstWidth; ++x) {
+				resampleAt(src, starts, weights, taps, dst, channels, x);
+			}
+			return;
+		}
+		// Two neighbouring pixels as 16-bit (c0 of p0, c0 of p1, c1 of p0, ...),
+		// so one multiply-add applies two taps to every channel. The second
+		// mask does the same for the next two pixels of a 16-byte load.
+		const int c = static_cast<int>(channels);
+		const __m128i pairs = _mm_setr_epi8(0, -1, c, -1, 1, -1, c + 1, -1, 2, -1, c + 2, -1,
+			c == 4 ? 3 : -1, -1, c == 4 ? 7 : -1, -1);
+		const __m128i nextPairs = _mm_add_epi8(pairs, _mm_and_si128(_mm_set1_epi8(static_cast<char>(2 * c)), _mm_cmpgt_epi8(pairs, _mm_set1_epi8(-1))));
+		const size_t rowBytes = srcWidth * channels;
+		for (size_t x = 0; x < dstWidth; ++x) {
+			const size_t offset = static_cast<size_t>(starts[x]) * channels;
+			const unsigned char* p = src + offset;
+			const short* w = weights + x * taps;
+			__m128i sum = _mm_setzero_si128();
+			int t = 0;
+			// The loads may read past the pixels they use, but not past the row.
+			for (; t + 4 <= taps && offset + static_cast<size_t>(t) * channels + 16 <= rowBytes; t += 4) {
+				const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + t * channels));
+				int weightPairs[2];
+				std::memcpy(weightPairs, w + t, sizeof(weightPairs));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_shuffle_epi8(pixels, pairs), _mm_set1_epi32(weightPairs[0])));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_shuffle_epi8(pixels, nextPairs), _mm_set1_epi32(weightPairs[1])));
+			}
+			for (; t + 2 <= taps && offset + static_cast<size_t>(t) * channels + 8 <= rowBytes; t += 2) {
+				const __m128i pixels = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + t * channels)), pairs);
+				int weightPair;
+				std::memcpy(&weightPair, w + t, sizeof(weightPair));
+				sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels, _mm_set1_epi32(weightPair)));
+			}
+			if (t == taps) {
+				const __m128i rounded = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << 13)), 14);
+				const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(rounded, rounded), rounded));
+				std::memcpy(dst + x * channels, &packed, channels);
+				continue;
+			}
+			alignas(16) int sums[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(sums), sum);
+			for (unsigned int k = 0; k < channels; ++k) {
+				for (int u = t; u < taps; ++u) sums[k] += w[u] * p[static_cast<size_t>(u) * channels + k];
+				dst[x * channels + k] = resampledOf(sums[k]);
+			}
+		}
+	}
+
+	void resampleColumns(const unsigned char* const* rows, const short* weights, int taps, unsigned char* dst, size_t count) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i half = _mm_set1_epi32(1 << 13);
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i s0 = half;
+			__m128i s1 = half;
+			__m128i s2 = half;
+			__m128i s3 = half;
+			for (int t = 0; t < taps; t += 2) {
+				const bool pair = t + 1 < taps;
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t] + i));
+				const __m128i b = pair ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[t + 1] + i)) : zero;
+				const __m128i weight = _mm_unpacklo_epi16(_mm_set1_epi16(weights[t]), _mm_set1_epi16(pair ? weights[t + 1] : 0));
+				const __m128i lo = _mm_unpacklo_epi8(a, b);
+				const __m128i hi = _mm_unpackhi_epi8(a, b);
+				s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), weight));
+				s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), weight));
+				s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), weight));
+				s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), weight));
+			}
+			const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(s0, 14), _mm_srai_epi32(s1, 14));
+			const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(s2, 14), _mm_srai_epi32(s3, 14));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+		}
+		for (; i < count; ++i) {
+			dst[i] = resampleColumnAt(rows, weights, taps, i);
+		}
+	}
+
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#endif
+
+void simd::installSse41(KernelTable& table) {
+	table.rgbToLuma = rgbToLuma;
+	table.invertColor = invertColor;
+	table.stencil3x3Row = stencil3x3Row;
+	table.gradient3x3Row = gradient3x3Row;
+	table.gradientMagnitude = gradientMagnitude;
+	table.replaceLuma = replaceLuma;
+	table.medianRow = medianRow;
+	table.diffusionRow = diffusionRow;
+	table.resampleRow = resampleRow;
+	table.resampleColumns = resampleColumns;
+}
+
+#endif // MINIPHOTOSHOP_X86
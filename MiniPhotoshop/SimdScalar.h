@@ -0,0 +1,112 @@
+#ifndef SIMD_SCALAR_H
+#define SIMD_SCALAR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Reference per-element versions of the dispatched kernels. The scalar
+// variant is built from these and the vector variants use them for their
+// tails, which keeps every path bit-identical. They are inline so units that
+// do not need every helper compile without unused-function warnings.
+
+namespace {
+
+	inline unsigned char lumaOf(const unsigned char* p) {
+		return static_cast<unsigned char>((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+	}
+
+	inline void replaceLumaAt(unsigned char* p, unsigned char luma) {
+		const int delta = luma - lumaOf(p);
+		for (int c = 0; c < 3; ++c) {
+			const int value = p[c] + delta;
+			p[c] = static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+		}
+	}
+
+	inline short stencilAt(const unsigned char* const rows[3], const short weights[9], std::ptrdiff_t i) {
+		int sum = 0;
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				sum += weights[r * 3 + c] * rows[r][i + c - 1];
+			}
+		}
+		return static_cast<short>(sum);
+	}
+
+	inline void gradientAt(const unsigned char* const rows[3], int center, std::ptrdiff_t i, short& gx, short& gy) {
+		const unsigned char* above = rows[0];
+		const unsigned char* row = rows[1];
+		const unsigned char* below = rows[2];
+		gx = static_cast<short>((above[i + 1] - above[i - 1]) + center * (row[i + 1] - row[i - 1]) + (below[i + 1] - below[i - 1]));
+		gy = static_cast<short>((below[i - 1] - above[i - 1]) + center * (below[i] - above[i]) + (below[i + 1] - above[i + 1]));
+	}
+
+	inline float magnitudeOf(short gx, short gy) {
+		return std::sqrt(static_cast<float>(gx * gx + gy * gy));
+	}
+
+	// exp(-t) for t >= 0: with y = t log2(e) = k + f, 2^-k is built from the
+	// exponent bits and 2^-f comes from its degree 5 Taylor polynomial. The
+	// vector kernels do the same operations in the same order.
+	inline float exponentialDecay(float t) {
+		const float y = std::fmin(t * 1.44269504f, 126.0f);
+		const float k = std::floor(y);
+		const float f = y - k;
+		const float p = 1.0f + f * (-0.693147181f + f * (0.240226507f + f * (-0.0555041087f + f * (0.00961812911f + f * -0.00133335581f))));
+		const std::int32_t bits = (127 - static_cast<std::int32_t>(k)) << 23;
+		float scale;
+		std::memcpy(&scale, &bits, sizeof(scale));
+		return p * scale;
+	}
+
+	// Perona-Malik conduction for t = (d / kappa)^2: 0 is exp(-t), 1 is
+	// 1 / (1 + t) and 2 is Tukey's biweight max(1 - t, 0)^2.
+	inline float conductionOf(int conduction, float t) {
+		if (conduction == 0) return exponentialDecay(t);
+		if (conduction == 1) return 1.0f / (1.0f + t);
+		const float u = std::fmax(1.0f - t, 0.0f);
+		return u * u;
+	}
+
+	inline float diffusionAt(const float* above, const float* row, const float* below, int conduction,
+		float inverseKappaSquared, float lambda, std::ptrdiff_t i) {
+		const float c = row[i];
+		const float dn = above[i] - c;
+		const float ds = below[i] - c;
+		const float de = row[i + 1] - c;
+		const float dw = row[i - 1] - c;
+		float flux = conductionOf(conduction, dn * dn * inverseKappaSquared) * dn;
+		flux = flux + conductionOf(conduction, ds * ds * inverseKappaSquared) * ds;
+		flux = flux + conductionOf(conduction, de * de * inverseKappaSquared) * de;
+		flux = flux + conductionOf(conduction, dw * dw * inverseKappaSquared) * dw;
+		return c + lambda * flux;
+	}
+
+	// Weighted sum with 14 fractional bits back to 8 bits, see resampleRow.
+	inline unsigned char resampledOf(int sum) {
+		return static_cast<unsigned char>(std::min(std::max((sum + (1 << 13)) >> 14, 0), 255));
+	}
+
+	inline void resampleAt(const unsigned char* src, const int* starts, const short* weights, int taps, unsigned char* dst,
+		unsigned int channels, size_t x) {
+		const unsigned char* p = src + static_cast<size_t>(starts[x]) * channels;
+		const short* w = weights + x * taps;
+		for (unsigned int c = 0; c < channels; ++c) {
+			int sum = 0;
+			for (int t = 0; t < taps; ++t) sum += w[t] * p[static_cast<size_t>(t) * channels + c];
+			dst[x * channels + c] = resampledOf(sum);
+		}
+	}
+
+	inline unsigned char resampleColumnAt(const unsigned char* const* rows, const short* weights, int taps, size_t i) {
+		int sum = 0;
+		for (int t = 0; t < taps; ++t) sum += weights[t] * rows[t][i];
+		return resampledOf(sum);
+	}
+
+}
+
+#endif // SIMD_SCALAR_H
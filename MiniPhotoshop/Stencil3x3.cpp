@@ -0,0 +1,130 @@
+#include "Stencil3x3.h"
+#include "CpuDispatch.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+	// Reads column x of the three rows through the horizontal border rule.
+	void gatherColumn(const unsigned char* const rows[3], int width, int x, BorderMode border, int out[3]) {
+		const int sx = borderCoordinate(x, width, border);
+		for (int r = 0; r < 3; ++r) {
+			out[r] = sx < 0 ? 0 : rows[r][sx];
+		}
+	}
+
+	// Neighbourhood of column x in row-major order, borders resolved.
+	void gatherNeighbourhood(const unsigned char* const rows[3], int width, int x, BorderMode border, int out[9]) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			int column[3];
+			gatherColumn(rows, width, x + dx, border, column);
+			for (int r = 0; r < 3; ++r) {
+				out[r * 3 + dx + 1] = column[r];
+			}
+		}
+	}
+
+	// Columns that the vector kernels cannot reach without reading outside the row.
+	template <typename Visit>
+	void forEachEdgeColumn(int width, Visit visit) {
+		if (width < 3) {
+			for (int x = 0; x < width; ++x) visit(x);
+			return;
+		}
+		visit(0);
+		visit(width - 1);
+	}
+
+	template <typename RowFunction>
+	void forEachSourceRow(const unsigned char* src, int width, int height, BorderMode border, RowFunction rowFunction) {
+		const std::vector<unsigned char> zeroRow(border == BorderMode::Zero ? width : 0, 0);
+
+#pragma omp parallel for
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* rows[3];
+			for (int k = 0; k < 3; ++k) {
+				rows[k] = borderRow(src, width, height, y + k - 1, border, zeroRow.data());
+			}
+			rowFunction(rows, static_cast<size_t>(y) * width);
+		}
+	}
+
+}
+
+const char* borderModeName(BorderMode mode) {
+	switch (mode) {
+	case BorderMode::Replicate: return "Replicate";
+	case BorderMode::Reflect: return "Reflect";
+	case BorderMode::Zero: return "Zero";
+	default: return "Unknown";
+	}
+}
+
+int borderCoordinate(int coordinate, int size, BorderMode mode) {
+	if (coordinate >= 0 && coordinate < size) {
+		return coordinate;
+	}
+
+	switch (mode) {
+	case BorderMode::Reflect: {
+		if (size == 1) return 0;
+		// Mirror around the edge pixel without repeating it: -1 -> 1, size -> size - 2.
+		const int period = 2 * (size - 1);
+		int c = coordinate % period;
+		if (c < 0) c += period;
+		return c < size ? c : period - c;
+	}
+	case BorderMode::Zero:
+		return -1;
+	default:
+		return std::clamp(coordinate, 0, size - 1);
+	}
+}
+
+const unsigned char* borderRow(const unsigned char* src, int width, int height, int y, BorderMode border, const unsigned char* zeroRow) {
+	const int sy = borderCoordinate(y, height, border);
+	return sy < 0 ? zeroRow : src + static_cast<size_t>(sy) * width;
+}
+
+void convolveRow3x3(const unsigned char* const rows[3], int width, const short weights[9], BorderMode border, short* dst) {
+	if (width >= 3) {
+		const unsigned char* interior[3] = { rows[0] + 1, rows[1] + 1, rows[2] + 1 };
+		kernels().stencil3x3Row(interior, weights, dst + 1, width - 2);
+	}
+
+	forEachEdgeColumn(width, [&](int x) {
+		int n[9];
+		gatherNeighbourhood(rows, width, x, border, n);
+		int sum = 0;
+		for (int k = 0; k < 9; ++k) {
+			sum += weights[k] * n[k];
+		}
+		dst[x] = static_cast<short>(sum);
+	});
+}
+
+void gradientRow3x3(const unsigned char* const rows[3], int width, int center, BorderMode border, short* gx, short* gy) {
+	if (width >= 3) {
+		const unsigned char* interior[3] = { rows[0] + 1, rows[1] + 1, rows[2] + 1 };
+		kernels().gradient3x3Row(interior, center, gx + 1, gy + 1, width - 2);
+	}
+
+	forEachEdgeColumn(width, [&](int x) {
+		int n[9];
+		gatherNeighbourhood(rows, width, x, border, n);
+		gx[x] = static_cast<short>((n[2] - n[0]) + center * (n[5] - n[3]) + (n[8] - n[6]));
+		gy[x] = static_cast<short>((n[6] - n[0]) + center * (n[7] - n[1]) + (n[8] - n[2]));
+	});
+}
+
+void convolve3x3(const unsigned char* src, int width, int height, const short weights[9], BorderMode border, short* dst) {
+	forEachSourceRow(src, width, height, border, [&](const unsigned char* const rows[3], size_t offset) {
+		convolveRow3x3(rows, width, weights, border, dst + offset);
+	});
+}
+
+void gradient3x3(const unsigned char* src, int width, int height, int center, BorderMode border, short* gx, short* gy) {
+	forEachSourceRow(src, width, height, border, [&](const unsigned char* const rows[3], size_t offset) {
+		gradientRow3x3(rows, width, center, border, gx + offset, gy + offset);
+	});
+}
@@ -0,0 +1,37 @@
+#ifndef STENCIL_3X3_H
+#define STENCIL_3X3_H
+
+enum class BorderMode {
+    Replicate = 0,
+    Reflect,
+    Zero,
+    Count
+};
+
+const char* borderModeName(BorderMode mode);
+
+// Maps an out-of-range coordinate back into [0, size). Returns -1 when the
+// sample is outside the image and the border mode reads it as zero.
+int borderCoordinate(int coordinate, int size, BorderMode mode);
+
+// Row y of an 8-bit plane with the vertical border rule applied. For
+// BorderMode::Zero rows outside the image resolve to `zeroRow`, which has to
+// hold `width` zeros.
+const unsigned char* borderRow(const unsigned char* src, int width, int height, int y, BorderMode border, const unsigned char* zeroRow);
+
+// 3x3 stencils over 8-bit data with int16 results. The interior columns run
+// through the dispatched vector kernels without any bounds checks, only the
+// first and last column go through the border rules.
+//
+// weights are row-major; the sum of their absolute values must stay at or
+// below 128 so that every result fits in int16.
+void convolveRow3x3(const unsigned char* const rows[3], int width, const short weights[9], BorderMode border, short* dst);
+
+// Sobel (center = 2) or Prewitt (center = 1) derivatives in one pass.
+void gradientRow3x3(const unsigned char* const rows[3], int width, int center, BorderMode border, short* gx, short* gy);
+
+// Whole-plane versions, parallel over rows.
+void convolve3x3(const unsigned char* src, int width, int height, const short weights[9], BorderMode border, short* dst);
+void gradient3x3(const unsigned char* src, int width, int height, int center, BorderMode border, short* gx, short* gy);
+
+#endif // STENCIL_3X3_H
@@ -1,5 +1,16 @@
 #include "Texture.h"
+#include "CpuDispatch.h"
+#include "Stencil3x3.h"
+#include "Canny.h"
+#include "Harris.h"
+#include "Pyramid.h"
+#include "Clahe.h"
+#include "Convolution.h"
+#include "ImageStats.h"
+#include "RecursiveGaussian.h"
 #include <vector>
+#include <cstring>
+#include <memory>
 #include <algorithm>
 #include <cmath>
 #include <string>
@@ -31,6 +42,7 @@ Texture::Texture(const Texture& other)
 
 Texture& Texture::operator=(const Texture& other) {
 	if (this != &other) {
+		cancelBackgroundWork();
 		width = other.width;
 		height = other.height;
 		nrChannel = other.nrChannel;
@@ -49,15 +61,18 @@ Texture& Texture::operator=(const Texture& other) {
 			nrChannel == 4 ? GL_RGBA : GL_RGB,
 			GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
+		invalidateCaches();
 	}
 	return *this;
 }
 
 Texture::~Texture() {
+	cancelBackgroundWork();
 	delete[] data;
 }
 
 void Texture::loadFromFile(const std::string& path) {
+	cancelBackgroundWork();
 	if (textureId != 0) {
 		delete[] data;
 	}
@@ -110,6 +125,7 @@ void Texture::loadFromFile(const std::string& path) {
 	glGenerateMipmap(GL_TEXTURE_2D);
 
 	stbi_image_free(imgData);
+	invalidateCaches();
 }
 
 
@@ -140,6 +156,14 @@ unsigned int Texture::getTextureId() const {
 	return this->textureId;
 }
 
+unsigned long long Texture::getGeneration() const {
+	return this->generation;
+}
+
+void Texture::invalidateCaches() {
+	++generation;
+}
+
 void Texture::updateTexture() {
 	if (!data) {
 		std::cout << "Pixel data is null" << std::endl;
@@ -152,11 +176,66 @@ void Texture::updateTexture() {
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glGenerateMipmap(GL_TEXTURE_2D);
 	glFlush();
+}
 
-	calculateHistogram();
+void Texture::resize(int newWidth, int newHeight, ResizeFilter filter) {
+	if (newWidth <= 0 || newHeight <= 0) {
+		throw std::runtime_error("Invalid image size: " + std::to_string(newWidth) + "x" + std::to_string(newHeight));
+	}
+	cancelBackgroundWork();
+	unsigned char* resized = new unsigned char[static_cast<size_t>(newWidth) * newHeight * nrChannel];
+	resizeImage(data, width, height, nrChannel, resized, newWidth, newHeight, filter);
+	replacePixels(resized, newWidth, newHeight);
+}
+
+void Texture::applyWarp(const WarpTransform& transform, int newWidth, int newHeight, WarpInterpolation interpolation) {
+	if (newWidth <= 0 || newHeight <= 0 || newWidth > MaxWarpSide || newHeight > MaxWarpSide
+		|| width > static_cast<unsigned int>(MaxWarpSide) || height > static_cast<unsigned int>(MaxWarpSide)) {
+		throw std::runtime_error("Warp sizes must be between 1 and " + std::to_string(MaxWarpSide));
+	}
+	cancelBackgroundWork();
+	unsigned char* warped = new unsigned char[static_cast<size_t>(newWidth) * newHeight * nrChannel];
+	warpImage(data, width, height, nrChannel, warped, newWidth, newHeight, transform, interpolation, borderMode);
+	replacePixels(warped, newWidth, newHeight);
+}
+
+void Texture::rotate(float degrees, bool expand, WarpInterpolation interpolation) {
+	int newWidth = static_cast<int>(width);
+	int newHeight = static_cast<int>(height);
+	if (expand) rotatedSize(degrees, newWidth, newHeight, newWidth, newHeight);
+	applyWarp(rotationTransform(degrees, width, height, newWidth, newHeight), newWidth, newHeight, interpolation);
+}
+
+void Texture::applyLensCorrection(const LensProfile& profile, WarpInterpolation interpolation) {
+	if (width > static_cast<unsigned int>(MaxWarpSide) || height > static_cast<unsigned int>(MaxWarpSide)) {
+		throw std::runtime_error("Warp sizes must be between 1 and " + std::to_string(MaxWarpSide));
+	}
+	const std::shared_ptr<const RemapTable> table = lensRemapTable(profile, width, height);
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	remapImage(data, width, height, nrChannel, result.data(), *table, interpolation, borderMode);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+void Texture::replacePixels(unsigned char* pixels, int newWidth, int newHeight) {
+	delete[] data;
+	data = pixels;
+	width = static_cast<unsigned int>(newWidth);
+	height = static_cast<unsigned int>(newHeight);
+
+	// updateTexture only replaces the pixels, the storage has to be
+	// allocated again for the new size.
+	const GLenum format = nrChannel == 4 ? GL_RGBA : GL_RGB;
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	invalidateCaches();
 }
 
 void Texture::applyGammaCorrection(float gamma) {
+	cancelBackgroundWork();
 	std::vector<unsigned char> dataVector(data, data + width * height * nrChannel);
 
 #pragma omp parallel for
@@ -167,9 +246,12 @@ void Texture::applyGammaCorrection(float gamma) {
 	}
 
 	std::memcpy(data, dataVector.data(), dataVector.size());
+
+	invalidateCaches();
 }
 
 void Texture::applyLog(float c) {
+	cancelBackgroundWork();
 	std::vector<unsigned char> dataVector(data, data + width * height * nrChannel);
 
 #pragma omp parallel for
@@ -180,34 +262,37 @@ void Texture::applyLog(float c) {
 	}
 
 	std::memcpy(data, dataVector.data(), dataVector.size());
+
+	invalidateCaches();
 }
 
 void Texture::negate() {
-	std::vector<unsigned char> dataVector(data, data + width * height * nrChannel);
+	cancelBackgroundWork();
+	const int rows = static_cast<int>(height);
 
 #pragma omp parallel for
-	for (size_t i = 0; i < dataVector.size(); ++i) {
-		if (i % nrChannel < 3) {
-			dataVector[i] = 255 - dataVector[i];
-		}
+	for (int y = 0; y < rows; ++y) {
+		kernels().invertColor(data + static_cast<size_t>(y) * width * nrChannel, width, nrChannel);
 	}
 
-	std::memcpy(data, dataVector.data(), dataVector.size());
+	invalidateCaches();
 }
 
 void Texture::toGray() {
+	cancelBackgroundWork();
+	const std::vector<unsigned char>& grayValues = luma();
+
 #pragma omp parallel for
 	for (int i = 0; i < width * height; ++i) {
 		int pixelOffset = i * nrChannel;
-		unsigned char r = data[pixelOffset];
-		unsigned char g = data[pixelOffset + 1];
-		unsigned char b = data[pixelOffset + 2];
-		unsigned char gray = static_cast<unsigned char>(0.299 * r + 0.587 * g + 0.114 * b);
-		data[pixelOffset] = data[pixelOffset + 1] = data[pixelOffset + 2] = gray;
+		data[pixelOffset] = data[pixelOffset + 1] = data[pixelOffset + 2] = grayValues[i];
 	}
+
+	invalidateCaches();
 }
 
-void Texture::applyColorHistogramEqualization() {
+void Texture::applyChannelHistogramEqualization() {
+	cancelBackgroundWork();
 	if (!data || width == 0 || height == 0) throw std::runtime_error("Invalid texture data");
 	const size_t totalPixels = width * height;
 	const int MAX_INTENSITY = 256;
@@ -251,23 +336,58 @@ void Texture::applyColorHistogramEqualization() {
 			data[idx] = lookupTables[idx % 3][data[idx]];
 		}
 	}
+
+	invalidateCaches();
 }
 
-void Texture::applyHistogramEqualization() {
+void Texture::applyColorHistogramEqualization() {
 	if (!data || width == 0 || height == 0) throw std::runtime_error("Invalid texture data");
 
 	const size_t totalPixels = width * height;
 	const int MAX_INTENSITY = 256;
-	std::vector<unsigned char> grayValues(totalPixels);
-	std::vector<int> histogram(MAX_INTENSITY, 0);
+	const std::vector<unsigned char>& grayValues = luma();
+	calculateHistogram();
+	cancelBackgroundWork();
+
+	std::vector<int> cdf(MAX_INTENSITY, 0);
+	std::partial_sum(grayHistogram.begin(), grayHistogram.end(), cdf.begin());
+	int cdfMin = *std::find_if(cdf.begin(), cdf.end(), [](int v) { return v > 0; });
 
-	for (size_t i = 0; i < totalPixels; ++i) {
-		const size_t pixelOffset = i * nrChannel;
-		unsigned char grayVal = static_cast<unsigned char>(0.299 * data[pixelOffset] + 0.587 * data[pixelOffset + 1] + 0.114 * data[pixelOffset + 2]);
-		grayValues[i] = grayVal;
-		histogram[grayVal]++;
+	std::array<unsigned char, MAX_INTENSITY> lookupTable;
+	const float scale = static_cast<float>(MAX_INTENSITY - 1) / std::max<size_t>(totalPixels - cdfMin, 1);
+	for (int i = 0; i < MAX_INTENSITY; ++i) {
+		lookupTable[i] = static_cast<unsigned char>(std::round(std::clamp((cdf[i] - cdfMin) * scale, 0.0f, 255.0f)));
 	}
 
+	// Equalizes Y of YCbCr and keeps Cb and Cr, one row at a time so the
+	// conversion, the lookup and the conversion back share a single sweep.
+	const int rows = static_cast<int>(height);
+#pragma omp parallel
+	{
+		std::vector<unsigned char> equalized(width);
+#pragma omp for
+		for (int y = 0; y < rows; ++y) {
+			const size_t rowStart = static_cast<size_t>(y) * width;
+			for (unsigned int x = 0; x < width; ++x) {
+				equalized[x] = lookupTable[grayValues[rowStart + x]];
+			}
+			kernels().replaceLuma(data + rowStart * nrChannel, equalized.data(), width, nrChannel);
+		}
+	}
+
+	invalidateCaches();
+}
+
+void Texture::applyHistogramEqualization() {
+	if (!data || width == 0 || height == 0) throw std::runtime_error("Invalid texture data");
+
+	const size_t totalPixels = width * height;
+	const int MAX_INTENSITY = 256;
+	const std::vector<unsigned char>& grayValues = luma();
+	calculateHistogram();
+	cancelBackgroundWork();
+	std::vector<int> histogram(grayHistogram.begin(), grayHistogram.end());
+
 	std::vector<int> cdf(MAX_INTENSITY, 0);
 	std::partial_sum(histogram.begin(), histogram.end(), cdf.begin());
 
@@ -279,305 +399,490 @@ void Texture::applyHistogramEqualization() {
 		lookupTable[i] = static_cast<unsigned char>(std::round(std::clamp((cdf[i] - cdfMin) * scale, 0.0f, 255.0f)));
 	}
 
-	for (size_t i = 0; i < totalPixels; ++i) {
-		const size_t pixelOffset = i * nrChannel;
+	const int numPixels = static_cast<int>(totalPixels);
+#pragma omp parallel for
+	for (int i = 0; i < numPixels; ++i) {
+		const size_t pixelOffset = static_cast<size_t>(i) * nrChannel;
 		unsigned char newValue = lookupTable[grayValues[i]];
 		data[pixelOffset] = newValue;
 		data[pixelOffset + 1] = newValue;
 		data[pixelOffset + 2] = newValue;
 		if (nrChannel == 4) data[pixelOffset + 3] = data[pixelOffset + 3];
 	}
+
+	invalidateCaches();
 }
 
-void Texture::applyBoxFilter(int size) {
-	int halfKernel = size / 2;
-	float kernelValue = 1.0f / (size * size);
-	auto newData = std::make_unique<unsigned char[]>(width * height * nrChannel);
-
-	auto clampCoords = [this](int coord, int max) {
-		return std::clamp(coord, 0, max - 1);
-		};
-
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			for (int c = 0; c < 3; ++c) {
-				float sum = 0.0f;
-				for (int ky = -halfKernel; ky <= halfKernel; ++ky) {
-					for (int kx = -halfKernel; kx <= halfKernel; ++kx) {
-						int nx = clampCoords(x + kx, width);
-						int ny = clampCoords(y + ky, height);
-						sum += data[(ny * width + nx) * nrChannel + c] * kernelValue;
-					}
-				}
-				newData[(y * width + x) * nrChannel + c] = static_cast<unsigned char>(std::clamp(sum, 0.0f, 255.0f));
-			}
-		}
-	}
+void Texture::applyClahe(int tilesX, int tilesY, float clipLimit, ClaheMode mode) {
+	cancelBackgroundWork();
+	if (!data || width == 0 || height == 0) throw std::runtime_error("Invalid texture data");
 
-	std::memcpy(data, newData.get(), width * height * nrChannel);
+	const ClaheParameters params{ tilesX, tilesY, clipLimit, mode };
+	const unsigned char* grayValues = mode == ClaheMode::Luminance ? luma().data() : nullptr;
+	::applyClahe(data, width, height, nrChannel, grayValues, params);
+
+	invalidateCaches();
+}
+
+void Texture::applyBoxFilter(int size) {
+	cancelBackgroundWork();
+	applyKernel(ConvolutionKernel::box(size));
+	invalidateCaches();
 }
 
 void Texture::applyGaussianFilter(int size) {
-	int halfSize = size / 2;
-	float sigma = 1.0f;
-	std::vector<float> kernel(size * size);
-	float sum = 0.0f;
-
-	for (int y = -halfSize; y <= halfSize; ++y) {
-		for (int x = -halfSize; x <= halfSize; ++x) {
-			float exponent = -(x * x + y * y) / (2 * sigma * sigma);
-			kernel[(y + halfSize) * size + (x + halfSize)] = exp(exponent) / (2 * 3.1415 * sigma * sigma);
-			sum += kernel[(y + halfSize) * size + (x + halfSize)];
-		}
-	}
+	cancelBackgroundWork();
+	applyKernel(ConvolutionKernel::gaussian(size, 1.0f));
+	invalidateCaches();
+}
 
-	for (float& val : kernel) {
-		val /= sum;
+void Texture::applyBilateralFilter(float sigmaSpatial, float sigmaRange) {
+	cancelBackgroundWork();
+	bilateralGrid(data, width, height, nrChannel, luma().data(), sigmaSpatial, sigmaRange);
+	invalidateCaches();
+}
+
+void Texture::applyUnsharpMask(float amount, float radius, int threshold) {
+	cancelBackgroundWork();
+	UnsharpParameters params;
+	params.amount = amount;
+	params.radius = radius;
+	params.threshold = threshold;
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	unsharpMask(data, result.data(), width, height, nrChannel, 3, params, borderMode);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+void Texture::applyHighPass(float radius) {
+	cancelBackgroundWork();
+	UnsharpParameters params;
+	params.radius = radius;
+	params.highPass = true;
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	unsharpMask(data, result.data(), width, height, nrChannel, 3, params, borderMode);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+int Texture::otsuThreshold() {
+	calculateHistogram();
+	return ::otsuThreshold(grayHistogram);
+}
+
+BinaryMask Texture::thresholdMask(ThresholdMethod method, int radius, float k) {
+	BinaryMask mask;
+	if (method == ThresholdMethod::Otsu) {
+		thresholdGlobal(luma().data(), width, height, otsuThreshold(), mask);
 	}
+	else {
+		thresholdAdaptive(luma().data(), width, height, method, radius, k, mask);
+	}
+	return mask;
+}
 
-	auto newData = std::make_unique<unsigned char[]>(width * height * nrChannel);
-	int halfKernel = size / 2;
+void Texture::applyThreshold(ThresholdMethod method, int radius, float k) {
+	const BinaryMask mask = thresholdMask(method, radius, k);
+	cancelBackgroundWork();
 
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			for (int c = 0; c < 3; ++c) {
-				float result = 0.0f;
-				for (int ky = -halfKernel; ky <= halfKernel; ++ky) {
-					for (int kx = -halfKernel; kx <= halfKernel; ++kx) {
-						int nx = std::clamp(x + kx, 0, (int)width - 1);
-						int ny = std::clamp(y + ky, 0, (int)height - 1);
-						int pixelIndex = (ny * width + nx) * nrChannel + c;
-						result += data[pixelIndex] * kernel[(ky + halfKernel) * size + (kx + halfKernel)];
-					}
-				}
-				int newIndex = (y * width + x) * nrChannel + c;
-				newData[newIndex] = static_cast<unsigned char>(std::clamp(result, 0.0f, 255.0f));
-			}
+#pragma omp parallel for
+	for (int y = 0; y < static_cast<int>(height); ++y) {
+		unsigned char* row = data + static_cast<size_t>(y) * width * nrChannel;
+		for (unsigned int x = 0; x < width; ++x) {
+			const unsigned char value = mask.at(x, y) ? 0 : 255;
+			row[x * nrChannel] = value;
+			row[x * nrChannel + 1] = value;
+			row[x * nrChannel + 2] = value;
 		}
 	}
 
-	std::memcpy(data, newData.get(), width * height * nrChannel);
+	invalidateCaches();
+}
+
+void Texture::applyAnisotropicDiffusion(const DiffusionParameters& params) {
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	anisotropicDiffusion(data, result.data(), width, height, nrChannel, 3, params);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+void Texture::applyNonLocalMeans(const NonLocalMeansParameters& params) {
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	nonLocalMeans(data, result.data(), width, height, nrChannel, 3, params);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+ImageLevel Texture::nonLocalMeansPreview(const NonLocalMeansParameters& params, long long maxPixels) {
+	int level = 0;
+	for (int w = width, h = height; static_cast<long long>(w) * h > maxPixels && level < maxPyramidLevels(); ++level) {
+		w = pyramidSize(w);
+		h = pyramidSize(h);
+	}
+
+	ImageLevel preview;
+	const unsigned char* pixels = data;
+	preview.width = width;
+	preview.height = height;
+	preview.channels = nrChannel;
+	if (level > 0) {
+		const ImageLevel& proxy = gaussianPyramid(level)[level - 1];
+		pixels = proxy.pixels.data();
+		preview.width = proxy.width;
+		preview.height = proxy.height;
+	}
+
+	// Every pyramid level halves the radii. Its filters add up to a Gaussian
+	// of sigma sqrt((4^level - 1) / 3), which leaves 1 / (2 sqrt(pi) sigma) of
+	// white noise, so the strength shrinks as much.
+	NonLocalMeansParameters scaled = params;
+	const float shrink = std::ldexp(1.0f, -level);
+	scaled.patchRadius = std::max(static_cast<int>(std::lround(params.patchRadius * shrink)), std::min(params.patchRadius, 1));
+	scaled.searchRadius = std::max(static_cast<int>(std::lround(params.searchRadius * shrink)), std::min(params.searchRadius, 1));
+	if (level > 0) {
+		const double Pi = 3.14159265358979323846;
+		const double sigma = std::sqrt((std::ldexp(1.0, 2 * level) - 1.0) / 3.0);
+		scaled.strength = static_cast<float>(params.strength / (2.0 * std::sqrt(Pi) * sigma));
+	}
+
+	preview.pixels.resize(static_cast<size_t>(preview.width) * preview.height * preview.channels);
+	nonLocalMeans(pixels, preview.pixels.data(), preview.width, preview.height, preview.channels, 3, scaled);
+	return preview;
+}
+
+void Texture::applyGuidedFilter(int radius, float epsilon, float detail) {
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	guidedFilter(data, result.data(), width, height, nrChannel, 0, 3, luma().data(), radius, epsilon, detail);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+void Texture::refineAlphaMatte(int radius, float epsilon) {
+	if (nrChannel != 4) throw std::runtime_error("Image has no alpha channel");
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	guidedFilter(data, result.data(), width, height, nrChannel, 3, 1, luma().data(), radius, epsilon, 0.0f);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+ConvolutionStrategy Texture::applyConvolution(const ConvolutionKernel& kernel, ConvolutionStrategy strategy) {
+	cancelBackgroundWork();
+	strategy = applyKernel(kernel, strategy);
+	invalidateCaches();
+	return strategy;
+}
+
+ConvolutionStrategy Texture::applyKernel(const ConvolutionKernel& kernel, ConvolutionStrategy strategy) {
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	strategy = convolve(data, result.data(), width, height, nrChannel, 3, kernel, borderMode, ConvolutionOutput::Saturate, strategy);
+	std::memcpy(data, result.data(), result.size());
+	return strategy;
+}
+
+void Texture::applyRecursiveGaussian(float sigma) {
+	cancelBackgroundWork();
+	recursiveGaussian(data, width, height, nrChannel, sigma);
+	invalidateCaches();
+}
+
+void Texture::applyLensBlur(int radius) {
+	cancelBackgroundWork();
+	applyKernel(ConvolutionKernel::disk(radius));
+	invalidateCaches();
+}
+
+void Texture::applyRankFilter(int radius, float percentile) {
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	rankFilter(data, result.data(), width, height, nrChannel, 3, radius, percentile, borderMode);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
+}
+
+void Texture::applyMorphology(MorphologyOperation operation, StructuringShape shape, int radiusX, int radiusY) {
+	cancelBackgroundWork();
+	std::vector<unsigned char> result(static_cast<size_t>(width) * height * nrChannel);
+	morphology(data, result.data(), width, height, nrChannel, 3, operation, shape, radiusX, radiusY);
+	std::memcpy(data, result.data(), result.size());
+	invalidateCaches();
 }
 
 void Texture::applySobelEdgeDetection() {
-	std::vector<unsigned char> tempData(width * height * nrChannel);
-	const float sobelX[9] = { -1, 0, 1, -2, 0, 2, -1, 0, 1 };
-	const float sobelY[9] = { -1, -2, -1, 0, 0, 0, 1, 2, 1 };
-
-#pragma omp parallel for collapse(2)
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			float gradX[3] = { 0.0f, 0.0f, 0.0f };
-			float gradY[3] = { 0.0f, 0.0f, 0.0f };
-
-			for (int ky = -1; ky <= 1; ++ky) {
-				for (int kx = -1; kx <= 1; ++kx) {
-					int srcIdx = ((y + ky) * width + (x + kx)) * nrChannel;
-					int kernelIdx = (ky + 1) * 3 + (kx + 1);
-
-					for (int c = 0; c < 3; ++c) {
-						gradX[c] += data[srcIdx + c] * sobelX[kernelIdx];
-						gradY[c] += data[srcIdx + c] * sobelY[kernelIdx];
-					}
-				}
-			}
+	cancelBackgroundWork();
+	const GradientField& field = gradients(GradientOperator::Sobel);
+	const int numPixels = static_cast<int>(width * height);
 
-			int destIdx = (y * width + x) * nrChannel;
-			for (int c = 0; c < 3; ++c) {
-				tempData[destIdx + c] = static_cast<unsigned char>(std::clamp(std::sqrt(gradX[c] * gradX[c] + gradY[c] * gradY[c]), 0.0f, 255.0f));
-			}
-			if (nrChannel == 4) {
-				tempData[destIdx + 3] = data[destIdx + 3];
-			}
-		}
+#pragma omp parallel for
+	for (int i = 0; i < numPixels; ++i) {
+		const unsigned char value = static_cast<unsigned char>(std::min(field.magnitude[i], 255.0f));
+		const int pixelOffset = i * nrChannel;
+		data[pixelOffset] = value;
+		data[pixelOffset + 1] = value;
+		data[pixelOffset + 2] = value;
 	}
 
-	std::memcpy(data, tempData.data(), width * height * nrChannel);
+	invalidateCaches();
 }
 
 void Texture::applyLaplaceEdgeDetection() {
-	float kernel[3][3] = { {0, 1, 0}, {1, -4, 1}, {0, 1, 0} };
-	int numPixels = width * height;
-	std::vector<unsigned char> grayValues(numPixels);
+	cancelBackgroundWork();
+	static const ConvolutionKernel kernel{ 3, 3, { 0, 1, 0, 1, -4, 1, 0, 1, 0 } };
+	const std::vector<unsigned char>& grayValues = luma();
+	const int numPixels = static_cast<int>(grayValues.size());
+	std::vector<unsigned char> response(numPixels);
+	convolve(grayValues.data(), response.data(), width, height, 1, 1, kernel, borderMode, ConvolutionOutput::Absolute);
 
 #pragma omp parallel for
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			int pixelOffset = (y * width + x) * nrChannel;
-			grayValues[y * width + x] = static_cast<unsigned char>(
-				0.299f * data[pixelOffset] + 0.587f * data[pixelOffset + 1] + 0.114f * data[pixelOffset + 2]);
-		}
+	for (int i = 0; i < numPixels; ++i) {
+		const int pixelOffset = i * nrChannel;
+		data[pixelOffset] = response[i];
+		data[pixelOffset + 1] = response[i];
+		data[pixelOffset + 2] = response[i];
 	}
 
-#pragma omp parallel for collapse(2)
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			int grad = 0;
-			for (int ky = -1; ky <= 1; ++ky) {
-				for (int kx = -1; kx <= 1; ++kx) {
-					int grayValue = grayValues[(y + ky) * width + (x + kx)];
-					grad += kernel[ky + 1][kx + 1] * grayValue;
-				}
-			}
-			int laplaceValue = std::clamp(std::abs(grad), 0, 255);
-			int pixelOffset = (y * width + x) * nrChannel;
-			data[pixelOffset] = laplaceValue;
-			data[pixelOffset + 1] = laplaceValue;
-			data[pixelOffset + 2] = laplaceValue;
-		}
+	invalidateCaches();
+}
+
+void Texture::applyCannyEdgeDetection(float sigma, float lowThreshold, float highThreshold) {
+	cancelBackgroundWork();
+	const CannyParameters params{ sigma, lowThreshold, highThreshold };
+	const int numPixels = static_cast<int>(width * height);
+	std::vector<unsigned char> edges(numPixels);
+
+	if (sigma <= 0.0f) {
+		const GradientField& field = gradients(GradientOperator::Sobel);
+		cannyEdgesFromGradients(field.gx.data(), field.gy.data(), width, height, params, edges.data());
+	}
+	else {
+		cannyEdges(luma().data(), width, height, params, borderMode, edges.data());
+	}
+
+#pragma omp parallel for
+	for (int i = 0; i < numPixels; ++i) {
+		const int pixelOffset = i * nrChannel;
+		data[pixelOffset] = edges[i];
+		data[pixelOffset + 1] = edges[i];
+		data[pixelOffset + 2] = edges[i];
 	}
+
+	invalidateCaches();
 }
 
-void Texture::detectCornersHarris(float k, float threshold) {
-	std::vector<unsigned char> originalData(data, data + width * height * nrChannel);
-	toGray();
+std::vector<Keypoint> Texture::detectCornersHarris(float k, float threshold, float windowSigma) {
+	const GradientField& field = gradients(GradientOperator::Sobel);
+	const HarrisParameters params{ k, threshold, windowSigma };
+	std::vector<Keypoint> corners = harrisCorners(field.gx.data(), field.gy.data(), width, height, params, borderMode);
+	sortByResponse(corners);
+	return corners;
+}
 
-	std::vector<float> gradX(width * height), gradY(width * height), cornerResponse(width * height);
-	const float sobelX[9] = { -1, 0, 1, -2, 0, 2, -1, 0, 1 };
-	const float sobelY[9] = { -1, -2, -1, 0, 0, 0, 1, 2, 1 };
+void Texture::applyPrewittFilter() {
+	cancelBackgroundWork();
+	const GradientField& field = gradients(GradientOperator::Prewitt);
+	const int numPixels = static_cast<int>(width * height);
 
-#pragma omp parallel for collapse(2)
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			float gx = 0.0f, gy = 0.0f;
-			for (int ky = -1; ky <= 1; ++ky) {
-				for (int kx = -1; kx <= 1; ++kx) {
-					int idx = ((y + ky) * width + (x + kx)) * nrChannel;
-					float val = static_cast<float>(data[idx]);
-					gx += val * sobelX[(ky + 1) * 3 + (kx + 1)];
-					gy += val * sobelY[(ky + 1) * 3 + (kx + 1)];
-				}
-			}
-			gradX[y * width + x] = gx;
-			gradY[y * width + x] = gy;
+#pragma omp parallel for
+	for (int i = 0; i < numPixels; ++i) {
+		const unsigned char value = static_cast<unsigned char>(std::min(field.magnitude[i], 255.0f));
+		const int pixelOffset = i * nrChannel;
+		data[pixelOffset] = value;
+		data[pixelOffset + 1] = value;
+		data[pixelOffset + 2] = value;
+	}
+
+	invalidateCaches();
+}
+
+void Texture::calculateHistogram() {
+	grayHistogram = stats().histogram(StatsChannel::Luma);
+}
+
+const ImageStats& Texture::stats() {
+	if (statsGeneration != generation) {
+		if (!backgroundStats.take(generation, statsCache, true)) {
+			statsCache = computeImageStats(data, width, height, nrChannel);
 		}
+		statsGeneration = generation;
 	}
+	return statsCache;
+}
 
-#pragma omp parallel for collapse(2)
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			float sumXX = 0.0f, sumYY = 0.0f, sumXY = 0.0f;
-			for (int wy = -1; wy <= 1; ++wy) {
-				for (int wx = -1; wx <= 1; ++wx) {
-					int idx = (y + wy) * width + (x + wx);
-					float gx = gradX[idx], gy = gradY[idx];
-					sumXX += gx * gx;
-					sumYY += gy * gy;
-					sumXY += gx * gy;
-				}
-			}
-			float det = sumXX * sumYY - sumXY * sumXY;
-			float trace = sumXX + sumYY;
-			cornerResponse[y * width + x] = det - k * trace * trace;
+const ImageStats& Texture::interactiveStats() {
+	const long long synchronousPixels = 4LL << 20;
+	const long long sampleCount = 1LL << 18;
+
+	if (statsGeneration == generation) {
+		return statsCache;
+	}
+	if (backgroundStats.take(generation, statsCache, false)) {
+		statsGeneration = generation;
+		return statsCache;
+	}
+	if (static_cast<long long>(width) * height <= synchronousPixels) {
+		return stats();
+	}
+
+	if (sampledGeneration != generation) {
+		sampledStats = sampleImageStats(data, width, height, nrChannel, sampleCount);
+		sampledGeneration = generation;
+		backgroundStats.start(data, width, height, nrChannel, generation);
+	}
+	return sampledStats;
+}
+
+void Texture::cancelBackgroundWork() {
+	backgroundStats.cancel();
+}
+
+void Texture::applyAutoLevels(float clipPercent, bool perChannel) {
+	const ImageStats& imageStats = stats();
+	// stats() waits for a running exact pass, so stop the worker only now.
+	cancelBackgroundWork();
+	const double fraction = std::clamp(clipPercent, 0.0f, 49.0f) / 100.0;
+	std::array<std::array<unsigned char, 256>, 3> lookupTables;
+
+	for (int channel = 0; channel < 3; ++channel) {
+		const StatsChannel source = perChannel ? static_cast<StatsChannel>(channel) : StatsChannel::Luma;
+		const int low = imageStats.percentile(source, fraction);
+		const int high = imageStats.percentile(source, 1.0 - fraction);
+		for (int v = 0; v < 256; ++v) {
+			lookupTables[channel][v] = high > low
+				? static_cast<unsigned char>(std::clamp((v - low) * 255 / (high - low), 0, 255))
+				: static_cast<unsigned char>(v);
 		}
 	}
 
-	std::memcpy(data, originalData.data(), width * height * nrChannel);
-
-	const int radius = 1;
-#pragma omp parallel for collapse(2)
-	for (int y = radius; y < height - radius; ++y) {
-		for (int x = radius; x < width - radius; ++x) {
-			if (cornerResponse[y * width + x] > threshold) {
-				bool isMax = true;
-				for (int wy = -1; wy <= 1 && isMax; ++wy) {
-					for (int wx = -1; wx <= 1 && isMax; ++wx) {
-						if (wx == 0 && wy == 0) continue;
-						if (cornerResponse[(y + wy) * width + (x + wx)] >= cornerResponse[y * width + x]) {
-							isMax = false;
-						}
-					}
-				}
-
-				if (isMax) {
-					for (int cy = -radius; cy <= radius; ++cy) {
-						for (int cx = -radius; cx <= radius; ++cx) {
-							if (cx * cx + cy * cy <= radius * radius) {
-								int px = x + cx, py = y + cy;
-								if (px >= 0 && px < width && py >= 0 && py < height) {
-									int idx = (py * width + px) * nrChannel;
-									data[idx] = 255; 
-									data[idx + 1] = 0;
-									data[idx + 2] = 0;
-								}
-							}
-						}
-					}
-				}
-			}
+	const int rows = static_cast<int>(height);
+#pragma omp parallel for
+	for (int y = 0; y < rows; ++y) {
+		unsigned char* row = data + static_cast<size_t>(y) * width * nrChannel;
+		for (unsigned int x = 0; x < width; ++x) {
+			unsigned char* p = row + static_cast<size_t>(x) * nrChannel;
+			p[0] = lookupTables[0][p[0]];
+			p[1] = lookupTables[1][p[1]];
+			p[2] = lookupTables[2][p[2]];
 		}
 	}
 
-	updateTexture();  // Frisstjk a textrt
+	invalidateCaches();
 }
 
-void Texture::applyPrewittFilter() {
-	const int prewittX[3][3] = {
-		{-1, 0, 1},
-		{-1, 0, 1},
-		{-1, 0, 1}
-	};
-
-	const int prewittY[3][3] = {
-		{-1, -1, -1},
-		{0, 0, 0},
-		{1, 1, 1}
-	};
-
-	int numPixels = width * height;
-	std::vector<unsigned char> newData(numPixels * nrChannel);
-	std::memcpy(newData.data(), data, numPixels * nrChannel);
-
-	std::vector<unsigned char> grayValues(numPixels);
+const std::vector<unsigned char>& Texture::luma() {
+	if (lumaGeneration == generation) {
+		return lumaCache;
+	}
+
+	lumaCache.resize(static_cast<size_t>(width) * height);
+	const int rows = static_cast<int>(height);
+
 #pragma omp parallel for
-	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; ++x) {
-			int pixelOffset = (y * width + x) * nrChannel;
-			grayValues[y * width + x] = static_cast<unsigned char>(
-				0.299f * data[pixelOffset] +
-				0.587f * data[pixelOffset + 1] +
-				0.114f * data[pixelOffset + 2]);
-		}
+	for (int y = 0; y < rows; ++y) {
+		const size_t rowStart = static_cast<size_t>(y) * width;
+		kernels().rgbToLuma(data + rowStart * nrChannel, lumaCache.data() + rowStart, width, nrChannel);
 	}
+	lumaGeneration = generation;
+	return lumaCache;
+}
 
-#pragma omp parallel for collapse(2)
-	for (int y = 1; y < height - 1; ++y) {
-		for (int x = 1; x < width - 1; ++x) {
-			int gradX = 0, gradY = 0;
-			for (int ky = -1; ky <= 1; ++ky) {
-				for (int kx = -1; kx <= 1; ++kx) {
-					int grayValue = grayValues[(y + ky) * width + (x + kx)];
-					gradX += prewittX[ky + 1][kx + 1] * grayValue;
-					gradY += prewittY[ky + 1][kx + 1] * grayValue;
-				}
-			}
+const GradientField& Texture::gradients(GradientOperator op, bool withOrientation) {
+	const size_t slot = static_cast<size_t>(op);
+	GradientField& field = gradientCache[slot];
+	const int numPixels = static_cast<int>(width * height);
+
+	if (gradientGeneration[slot] != generation) {
+		const std::vector<unsigned char>& grayValues = luma();
+		field.gx.resize(numPixels);
+		field.gy.resize(numPixels);
+		field.magnitude.resize(numPixels);
+		field.orientation.clear();
 
-			int magnitude = static_cast<int>(std::sqrt(gradX * gradX + gradY * gradY));
-			unsigned char newGrayValue = std::clamp(magnitude, 0, 255);
+		const int center = op == GradientOperator::Sobel ? 2 : 1;
+		gradient3x3(grayValues.data(), width, height, center, borderMode, field.gx.data(), field.gy.data());
 
-			int newIdx = (y * width + x) * nrChannel;
-			newData[newIdx] = newGrayValue;
-			newData[newIdx + 1] = newGrayValue;
-			newData[newIdx + 2] = newGrayValue;
+		const int rows = static_cast<int>(height);
+#pragma omp parallel for
+		for (int y = 0; y < rows; ++y) {
+			const size_t rowStart = static_cast<size_t>(y) * width;
+			kernels().gradientMagnitude(field.gx.data() + rowStart, field.gy.data() + rowStart, field.magnitude.data() + rowStart, width);
 		}
+		gradientGeneration[slot] = generation;
 	}
 
-	std::memcpy(data, newData.data(), numPixels * nrChannel);
+	if (withOrientation && field.orientation.size() != field.gx.size()) {
+		field.orientation.resize(numPixels);
+#pragma omp parallel for
+		for (int i = 0; i < numPixels; ++i) {
+			field.orientation[i] = std::atan2(static_cast<float>(field.gy[i]), static_cast<float>(field.gx[i]));
+		}
+	}
+	return field;
 }
 
-void Texture::calculateHistogram() {
-	grayHistogram.fill(0);
+void Texture::setBorderMode(BorderMode mode) {
+	if (mode != borderMode) {
+		borderMode = mode;
+		gradientGeneration.fill(~0ULL);
+		gaussianGeneration = ~0ULL;
+		laplacianGeneration = ~0ULL;
+	}
+}
 
-#pragma omp parallel for
-	for (unsigned int i = 0; i < width * height; i++) {
-		const unsigned char r = data[i * nrChannel];
-		const unsigned char g = data[i * nrChannel + 1];
-		const unsigned char b = data[i * nrChannel + 2];
-
-		const unsigned char gray = static_cast<unsigned char>(
-			0.299f * r + 0.587f * g + 0.114f * b
-			);
-#pragma omp atomic
-		grayHistogram[gray]++;
+BorderMode Texture::getBorderMode() const {
+	return borderMode;
+}
+
+int Texture::maxPyramidLevels() const {
+	int levels = 0;
+	for (int w = width, h = height; w > 1 || h > 1; w = pyramidSize(w), h = pyramidSize(h)) {
+		++levels;
+	}
+	return levels;
+}
+
+const std::vector<ImageLevel>& Texture::gaussianPyramid(int levels) {
+	if (gaussianGeneration != generation) {
+		gaussianLevels.clear();
+		gaussianGeneration = generation;
+	}
+
+	levels = std::min(levels, maxPyramidLevels());
+	while (static_cast<int>(gaussianLevels.size()) < levels) {
+		ImageLevel next;
+		if (gaussianLevels.empty()) {
+			pyrDown(data, width, height, nrChannel, borderMode, next);
+		}
+		else {
+			const ImageLevel& previous = gaussianLevels.back();
+			pyrDown(previous.pixels.data(), previous.width, previous.height, previous.channels, borderMode, next);
+		}
+		gaussianLevels.push_back(std::move(next));
+	}
+	return gaussianLevels;
+}
+
+const std::vector<LaplacianLevel>& Texture::laplacianPyramid(int levels) {
+	const std::vector<ImageLevel>& gaussian = gaussianPyramid(levels);
+	if (laplacianGeneration != generation) {
+		laplacianLevels.clear();
+		laplacianGeneration = generation;
+	}
+
+	levels = std::min(levels, static_cast<int>(gaussian.size()));
+	while (static_cast<int>(laplacianLevels.size()) < levels) {
+		const size_t i = laplacianLevels.size();
+		LaplacianLevel level;
+		if (i == 0) {
+			pyrLaplacian(data, width, height, gaussian[0], borderMode, level);
+		}
+		else {
+			const ImageLevel& fine = gaussian[i - 1];
+			pyrLaplacian(fine.pixels.data(), fine.width, fine.height, gaussian[i], borderMode, level);
+		}
+		laplacianLevels.push_back(std::move(level));
 	}
+	return laplacianLevels;
 }
\ No newline at end of file
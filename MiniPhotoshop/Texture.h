@@ -8,6 +8,40 @@
 #include "stb_image_write.h"
 #include <iostream>
 #include <array>
+#include <vector>
+
+#include "AnisotropicDiffusion.h"
+#include "BilateralGrid.h"
+#include "Clahe.h"
+#include "Convolution.h"
+#include "GuidedFilter.h"
+#include "ImageStats.h"
+#include "Keypoint.h"
+#include "Morphology.h"
+#include "NonLocalMeans.h"
+#include "Pyramid.h"
+#include "RankFilter.h"
+#include "Resize.h"
+#include "Stencil3x3.h"
+#include "Threshold.h"
+#include "UnsharpMask.h"
+#include "Warp.h"
+
+enum class GradientOperator {
+    Sobel = 0,
+    Prewitt,
+    Count
+};
+
+// 3x3 gradients of the luma plane. Everything that needs derivatives reads
+// the same field, so it is only computed once per pixel generation.
+// orientation stays empty until a caller asks for it.
+struct GradientField {
+    std::vector<short> gx;
+    std::vector<short> gy;
+    std::vector<float> magnitude;
+    std::vector<float> orientation;
+};
 
 class Texture {
 public:
@@ -22,32 +56,144 @@ public:
     void applyLog(float c);
     void negate();
     void toGray();
+    // Resamples the image to newWidth x newHeight and re-creates the GL
+    // texture at that size. Throws std::runtime_error for empty sizes.
+    void resize(int newWidth, int newHeight, ResizeFilter filter);
+    // Output pixel (x, y) samples the image at transform (x, y, 1), see
+    // warpImage; samples outside follow the border mode. The image becomes
+    // newWidth x newHeight. Throws std::runtime_error for sizes outside
+    // 1..MaxWarpSide.
+    void applyWarp(const WarpTransform& transform, int newWidth, int newHeight, WarpInterpolation interpolation);
+    // Counterclockwise about the center. With `expand` the image grows to
+    // hold all of the rotated image, otherwise it keeps its size.
+    void rotate(float degrees, bool expand, WarpInterpolation interpolation);
+    // Undoes the distortion of `profile`. The remap table is shared with every
+    // image of the same size corrected for the same profile.
+    void applyLensCorrection(const LensProfile& profile, WarpInterpolation interpolation);
+    // Equalizes luma only, hue and saturation are preserved.
     void applyColorHistogramEqualization();
+    // Equalizes R, G and B independently.
+    void applyChannelHistogramEqualization();
     void applyHistogramEqualization();
+    void applyClahe(int tilesX, int tilesY, float clipLimit, ClaheMode mode);
+    // Stretches the range between the clipPercent and 100 - clipPercent
+    // percentiles to 0..255, per channel or with the luma range for all.
+    void applyAutoLevels(float clipPercent, bool perChannel);
     void applyBoxFilter(int size);
     void applyGaussianFilter(int size);
+    // Edge-preserving smoothing, edges are taken from the luma plane.
+    void applyBilateralFilter(float sigmaSpatial, float sigmaRange);
+    // Guided filter of the color channels with the luma as guide, see
+    // guidedFilter for epsilon and detail.
+    void applyGuidedFilter(int radius, float epsilon, float detail);
+    // Snaps a rough alpha matte to the edges of the luma plane. Throws
+    // std::runtime_error for images without alpha.
+    void refineAlphaMatte(int radius, float epsilon);
+    // IIR approximation with a cost independent of sigma, for large radii.
+    void applyRecursiveGaussian(float sigma);
+    // Disk kernel, so highlights become circles like an out of focus lens.
+    // Large radii go through the FFT path of the convolution engine.
+    void applyLensBlur(int radius);
+    // Percentile of the (2 radius + 1)^2 window per color channel: 50 is the
+    // median, 0 the minimum and 100 the maximum.
+    void applyRankFilter(int radius, float percentile);
+    // Sharpens the color channels, see UnsharpParameters.
+    void applyUnsharpMask(float amount, float radius, int threshold);
+    // Replaces the color channels with 128 + (p - blur(p)).
+    void applyHighPass(float radius);
+    // Perona-Malik diffusion of each color channel.
+    void applyAnisotropicDiffusion(const DiffusionParameters& params);
+    void applyNonLocalMeans(const NonLocalMeansParameters& params);
+    // Non-local means of the largest Gaussian level with at most maxPixels
+    // pixels (the image itself if it is small enough), radii and strength
+    // scaled to that level. Leaves the pixels untouched.
+    ImageLevel nonLocalMeansPreview(const NonLocalMeansParameters& params, long long maxPixels);
+    void applyMorphology(MorphologyOperation operation, StructuringShape shape, int radiusX, int radiusY);
+    // Otsu's threshold of the luma histogram from calculateHistogram.
+    int otsuThreshold();
+    // Ink mask of the luma plane. Otsu ignores radius and k.
+    BinaryMask thresholdMask(ThresholdMethod method, int radius, float k);
+    // Color channels become black for ink and white elsewhere.
+    void applyThreshold(ThresholdMethod method, int radius, float k);
+    // Color channels through the convolution engine, with the current border
+    // mode. Returns the strategy Auto resolved to.
+    ConvolutionStrategy applyConvolution(const ConvolutionKernel& kernel, ConvolutionStrategy strategy = ConvolutionStrategy::Auto);
     void applySobelEdgeDetection();
     void applyLaplaceEdgeDetection();
     void applyPrewittFilter();
-    void detectCornersHarris(float k, float threshold);
+    void applyCannyEdgeDetection(float sigma, float lowThreshold, float highThreshold);
+    // Strongest first, see sortByResponse. Leaves the pixels untouched.
+    std::vector<Keypoint> detectCornersHarris(float k, float threshold, float windowSigma = 1.0f);
     void updateTexture();
     void writeToFile(const char* path) const;
+    // Copies the luma histogram of stats() into grayHistogram. Blocks until
+    // the exact pass is done, so the display uses interactiveStats() instead.
     void calculateHistogram();
+    const ImageStats& stats();
+    // Exact statistics when they are ready. Otherwise a sampled estimate,
+    // while the exact pass runs on a worker thread; large images are never
+    // scanned in full on the calling thread.
+    const ImageStats& interactiveStats();
+
+    const std::vector<unsigned char>& luma();
+    const GradientField& gradients(GradientOperator op, bool withOrientation = false);
+
+    // Gaussian levels below the image, level i is 2^(i + 1) times smaller.
+    // Only missing levels are built and all of them are dropped when the
+    // pixels change. Holds at least min(levels, maxPyramidLevels()) entries;
+    // a later call with more levels may move them.
+    const std::vector<ImageLevel>& gaussianPyramid(int levels);
+    // Level i is Gaussian level i (the image for i = 0) minus the expansion
+    // of Gaussian level i + 1, whose last entry is the residual.
+    const std::vector<LaplacianLevel>& laplacianPyramid(int levels);
+    int maxPyramidLevels() const;
+
+    void setBorderMode(BorderMode mode);
+    BorderMode getBorderMode() const;
 
     unsigned char* getData() const;
     unsigned int getWidth()const;
     unsigned int getHeight() const;
     unsigned int getNrChannel() const;
     unsigned int getTextureId() const;
+    unsigned long long getGeneration() const;
 
     std::array<int, 256> grayHistogram{0};
 
 private:
+    // Called by every operation that rewrites the pixels, so cached planes
+    // derived from the previous pixels are rebuilt on next use.
+    void invalidateCaches();
+    // Called before the pixels are written or freed, so that no worker is
+    // still reading them.
+    void cancelBackgroundWork();
+    // Takes `pixels` (allocated with new[]) as the image, which is now
+    // newWidth x newHeight, and re-allocates the GL texture for that size.
+    void replacePixels(unsigned char* pixels, int newWidth, int newHeight);
+    // applyConvolution without the cancel and invalidate bookkeeping.
+    ConvolutionStrategy applyKernel(const ConvolutionKernel& kernel, ConvolutionStrategy strategy = ConvolutionStrategy::Auto);
+
     unsigned char* data;
     unsigned int textureId{ 0 };
     unsigned int width{ 0 };
     unsigned int height{ 0 };
     unsigned int nrChannel{ 0 };
+
+    BorderMode borderMode{ BorderMode::Replicate };
+    unsigned long long generation{ 0 };
+    std::vector<unsigned char> lumaCache;
+    unsigned long long lumaGeneration{ ~0ULL };
+    std::array<GradientField, static_cast<size_t>(GradientOperator::Count)> gradientCache;
+    std::array<unsigned long long, static_cast<size_t>(GradientOperator::Count)> gradientGeneration{ ~0ULL, ~0ULL };
+    ImageStats statsCache;
+    unsigned long long statsGeneration{ ~0ULL };
+    ImageStats sampledStats;
+    unsigned long long sampledGeneration{ ~0ULL };
+    BackgroundStats backgroundStats;
+    std::vector<ImageLevel> gaussianLevels;
+    unsigned long long gaussianGeneration{ ~0ULL };
+    std::vector<LaplacianLevel> laplacianLevels;
+    unsigned long long laplacianGeneration{ ~0ULL };
 };
 
 #endif // TEXTURE_H
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "Threshold.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+	const int ColumnBlock = 1024;
+
+	void resizeMask(int width, int height, BinaryMask& mask) {
+		mask.width = width;
+		mask.height = height;
+		mask.stride = (width + 7) / 8;
+		mask.bits.assign(static_cast<size_t>(mask.stride) * height, 0);
+	}
+
+	// Packs one row of ink flags into the mask row y.
+	void packRow(const unsigned char* ink, int width, int y, BinaryMask& mask) {
+		unsigned char* row = mask.bits.data() + static_cast<size_t>(y) * mask.stride;
+		for (int x = 0; x < width; x += 8) {
+			unsigned char byte = 0;
+			const int count = std::min(8, width - x);
+			for (int i = 0; i < count; ++i) byte |= static_cast<unsigned char>(ink[x + i] << (7 - i));
+			row[x / 8] = byte;
+		}
+	}
+
+	// (width + 1) x (height + 1) integral images of the levels and their
+	// squares, modulo 2^32.
+	void buildIntegrals(const unsigned char* plane, int width, int height,
+		std::vector<std::uint32_t>& sums, std::vector<std::uint32_t>& squares) {
+		const size_t stride = static_cast<size_t>(width) + 1;
+		sums.assign(stride * (height + 1), 0);
+		squares.assign(stride * (height + 1), 0);
+
+#pragma omp parallel for
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* row = plane + static_cast<size_t>(y) * width;
+			std::uint32_t* sum = sums.data() + (y + 1) * stride + 1;
+			std::uint32_t* square = squares.data() + (y + 1) * stride + 1;
+			std::uint32_t runningSum = 0;
+			std::uint32_t runningSquare = 0;
+			for (int x = 0; x < width; ++x) {
+				runningSum += row[x];
+				runningSquare += static_cast<std::uint32_t>(row[x]) * row[x];
+				sum[x] = runningSum;
+				square[x] = runningSquare;
+			}
+		}
+
+		const int blocks = (width + ColumnBlock - 1) / ColumnBlock;
+#pragma omp parallel for
+		for (int b = 0; b < blocks; ++b) {
+			const size_t x0 = static_cast<size_t>(b) * ColumnBlock + 1;
+			const size_t x1 = std::min(x0 + ColumnBlock, stride);
+			for (int y = 2; y <= height; ++y) {
+				std::uint32_t* sum = sums.data() + y * stride;
+				std::uint32_t* square = squares.data() + y * stride;
+				for (size_t x = x0; x < x1; ++x) {
+					sum[x] += sum[x - stride];
+					square[x] += square[x - stride];
+				}
+			}
+		}
+	}
+
+}
+
+const char* thresholdMethodName(ThresholdMethod method) {
+	switch (method) {
+	case ThresholdMethod::Otsu: return "Otsu";
+	case ThresholdMethod::Niblack: return "Niblack";
+	case ThresholdMethod::Sauvola: return "Sauvola";
+	default: return "Unknown";
+	}
+}
+
+int otsuThreshold(const std::array<int, 256>& histogram) {
+	double total = 0.0;
+	double weightedTotal = 0.0;
+	for (int i = 0; i < 256; ++i) {
+		total += histogram[i];
+		weightedTotal += static_cast<double>(i) * histogram[i];
+	}
+
+	int best = 0;
+	double bestVariance = -1.0;
+	double below = 0.0;
+	double weightedBelow = 0.0;
+	for (int t = 0; t < 255; ++t) {
+		below += histogram[t];
+		weightedBelow += static_cast<double>(t) * histogram[t];
+		const double above = total - below;
+		if (below == 0.0 || above == 0.0) continue;
+		const double meanDifference = weightedBelow / below - (weightedTotal - weightedBelow) / above;
+		const double variance = below * above * meanDifference * meanDifference;
+		if (variance > bestVariance) {
+			bestVariance = variance;
+			best = t;
+		}
+	}
+	return best;
+}
+
+void thresholdGlobal(const unsigned char* plane, int width, int height, int threshold, BinaryMask& mask) {
+	resizeMask(width, height, mask);
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> ink(width);
+
+#pragma omp for
+		for (int y = 0; y < height; ++y) {
+			const unsigned char* row = plane + static_cast<size_t>(y) * width;
+			for (int x = 0; x < width; ++x) ink[x] = row[x] <= threshold ? 1 : 0;
+			packRow(ink.data(), width, y, mask);
+		}
+	}
+}
+
+void thresholdAdaptive(const unsigned char* plane, int width, int height, ThresholdMethod method, int radius, float k,
+	BinaryMask& mask) {
+	resizeMask(width, height, mask);
+	if (width <= 0 || height <= 0) return;
+	radius = std::min(std::max(radius, 1), MaxThresholdRadius);
+
+	std::vector<std::uint32_t> sums;
+	std::vector<std::uint32_t> squares;
+	buildIntegrals(plane, width, height, sums, squares);
+	const size_t stride = static_cast<size_t>(width) + 1;
+	const bool sauvola = method == ThresholdMethod::Sauvola;
+
+#pragma omp parallel
+	{
+		std::vector<unsigned char> ink(width);
+
+#pragma omp for schedule(dynamic, 16)
+		for (int y = 0; y < height; ++y) {
+			const int y0 = std::max(y - radius, 0);
+			const int y1 = std::min(y + radius + 1, height);
+			const std::uint32_t* sumTop = sums.data() + y0 * stride;
+			const std::uint32_t* sumBottom = sums.data() + y1 * stride;
+			const std::uint32_t* squareTop = squares.data() + y0 * stride;
+			const std::uint32_t* squareBottom = squares.data() + y1 * stride;
+			const unsigned char* row = plane + static_cast<size_t>(y) * width;
+			for (int x = 0; x < width; ++x) {
+				const int x0 = std::max(x - radius, 0);
+				const int x1 = std::min(x + radius + 1, width);
+				const double count = static_cast<double>(x1 - x0) * (y1 - y0);
+				const std::uint32_t sum = sumBottom[x1] - sumBottom[x0] - sumTop[x1] + sumTop[x0];
+				const std::uint32_t square = squareBottom[x1] - squareBottom[x0] - squareTop[x1] + squareTop[x0];
+				const double mean = sum / count;
+				const double deviation = std::sqrt(std::max(square / count - mean * mean, 0.0));
+				const double threshold = sauvola ? mean * (1.0 + k * (deviation / 128.0 - 1.0)) : mean + k * deviation;
+				ink[x] = row[x] <= threshold ? 1 : 0;
+			}
+			packRow(ink.data(), width, y, mask);
+		}
+	}
+}
+
+void writeMaskPbm(const char* path, const BinaryMask& mask) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "Cannot write file into path: " << path << std::endl;
+		return;
+	}
+
+	file << "P4\n" << mask.width << ' ' << mask.height << '\n';
+	file.write(reinterpret_cast<const char*>(mask.bits.data()), static_cast<std::streamsize>(mask.bits.size()));
+}
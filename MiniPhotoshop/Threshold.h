@@ -0,0 +1,54 @@
+#ifndef THRESHOLD_H
+#define THRESHOLD_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+const int MaxThresholdRadius = 127;
+
+enum class ThresholdMethod {
+    // One global threshold from the histogram.
+    Otsu = 0,
+    // mean + k * stddev of the window, k around -0.2.
+    Niblack,
+    // mean * (1 + k * (stddev / 128 - 1)), k around 0.34; keeps flat
+    // background clean where Niblack turns noise into ink.
+    Sauvola,
+    Count
+};
+
+const char* thresholdMethodName(ThresholdMethod method);
+
+// 1 bit per pixel, set for ink: pixels at or below the threshold. Rows are
+// padded to whole bytes and the leftmost pixel is the high bit, which is the
+// layout of binary PBM files.
+struct BinaryMask {
+    int width{ 0 };
+    int height{ 0 };
+    int stride{ 0 };
+    std::vector<unsigned char> bits;
+
+    bool at(int x, int y) const {
+        return (bits[static_cast<size_t>(y) * stride + x / 8] >> (7 - x % 8)) & 1;
+    }
+};
+
+// Level that maximizes the between-class variance of the two classes
+// <= level and > level.
+int otsuThreshold(const std::array<int, 256>& histogram);
+
+void thresholdGlobal(const unsigned char* plane, int width, int height, int threshold, BinaryMask& mask);
+
+// Niblack or Sauvola over the (2 radius + 1)^2 window clipped to the image.
+// Means and deviations come from integral images of the sum and the squared
+// sum, so every pixel costs the same whatever the radius. Both are kept in
+// 32 bits: their differences wrap around to the exact window sums as long as
+// those fit, which they do up to MaxThresholdRadius.
+void thresholdAdaptive(const unsigned char* plane, int width, int height, ThresholdMethod method, int radius, float k,
+    BinaryMask& mask);
+
+// Binary PBM (P4), ink is black.
+void writeMaskPbm(const char* path, const BinaryMask& mask);
+
+#endif // THRESHOLD_H
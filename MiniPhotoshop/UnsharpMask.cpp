@@ -0,0 +1,69 @@
+#include "UnsharpMask.h"
+#include "Convolution.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	const int StripRows = 64;
+
+}
+
+void unsharpMask(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+	const UnsharpParameters& params, BorderMode border) {
+	if (width <= 0 || height <= 0) return;
+	planes = std::min(planes, channels);
+	const float sigma = std::max(params.radius, 0.1f);
+	const int radius = std::max(static_cast<int>(std::ceil(3.0f * sigma)), 1);
+	const int ringRows = 2 * radius + 1;
+	const std::vector<float> taps = gaussianTaps(ringRows, sigma);
+	const size_t rowSize = static_cast<size_t>(width) * channels;
+	const float threshold = static_cast<float>(params.threshold);
+	const float base = params.highPass ? 128.0f : 0.0f;
+	const float keep = params.highPass ? 0.0f : 1.0f;
+	// Every strip first fills the ring with 2 * radius rows, so strips grow
+	// with the radius to keep that overhead small.
+	const int stripRows = std::max(StripRows, 8 * radius);
+	const int strips = (height + stripRows - 1) / stripRows;
+
+#pragma omp parallel
+	{
+		std::vector<float> padded(static_cast<size_t>(width + 2 * radius) * channels);
+		std::vector<float> ring(static_cast<size_t>(ringRows) * rowSize);
+		std::vector<float> blurred(rowSize);
+		std::vector<const float*> sources(ringRows);
+		auto slot = [&](int y) { return ring.data() + static_cast<size_t>(((y % ringRows) + ringRows) % ringRows) * rowSize; };
+		auto push = [&](int y) {
+			loadPaddedRow(src, width, height, channels, y, radius, radius, border, padded.data());
+			for (int k = 0; k < ringRows; ++k) sources[k] = padded.data() + static_cast<size_t>(k) * channels;
+			weightedRowSum(sources.data(), taps.data(), ringRows, rowSize, slot(y));
+		};
+
+#pragma omp for schedule(dynamic)
+		for (int s = 0; s < strips; ++s) {
+			const int y0 = s * stripRows;
+			const int y1 = std::min(y0 + stripRows, height);
+			for (int y = y0 - radius; y < y0 + radius; ++y) push(y);
+
+			for (int y = y0; y < y1; ++y) {
+				push(y + radius);
+				for (int k = 0; k < ringRows; ++k) sources[k] = slot(y - radius + k);
+				weightedRowSum(sources.data(), taps.data(), ringRows, rowSize, blurred.data());
+
+				const unsigned char* in = src + static_cast<size_t>(y) * rowSize;
+				unsigned char* out = dst + static_cast<size_t>(y) * rowSize;
+				for (size_t i = 0; i < rowSize; ++i) {
+					const float value = in[i];
+					const float detail = value - blurred[i];
+					const float sharpened = base + keep * value + params.amount * detail;
+					const float result = std::abs(detail) < threshold ? base + keep * value : sharpened;
+					out[i] = static_cast<unsigned char>(std::min(std::max(result + 0.5f, 0.0f), 255.0f));
+				}
+				for (int c = planes; c < channels; ++c) {
+					for (size_t i = c; i < rowSize; i += channels) out[i] = in[i];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef UNSHARP_MASK_H
+#define UNSHARP_MASK_H
+
+#include "Stencil3x3.h"
+
+struct UnsharpParameters {
+    // Gain on the detail, 1 doubles the difference to the blurred image.
+    float amount{ 1.0f };
+    // Sigma of the Gaussian blur, in pixels.
+    float radius{ 1.0f };
+    // Differences below this many levels are left alone, so flat areas and
+    // noise are not sharpened.
+    int threshold{ 0 };
+    // Writes 128 + amount * (p - blur) instead, the high-pass layer itself.
+    bool highPass{ false };
+};
+
+// p + amount * (p - blur(p)) on the first `planes` channels, the rest are
+// copied. Blur, difference, threshold and add are one pass: each thread
+// keeps a ring of 2 * ceil(3 radius) + 1 horizontally blurred rows and
+// finishes every output row as soon as the ring covers it, so no blurred
+// copy of the image is ever stored. Both blur passes are the row sums of
+// convolve. Row strips run in parallel.
+void unsharpMask(const unsigned char* src, unsigned char* dst, int width, int height, int channels, int planes,
+    const UnsharpParameters& params, BorderMode border);
+
+#endif // UNSHARP_MASK_H
@@ -0,0 +1,407 @@
+#include "Warp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+
+namespace {
+
+	const int TileSize = 64;
+	const int One = 1 << WarpFractionBits;
+	const int FractionMask = One - 1;
+	// Per axis weights sum to 1 << WeightBits, so a 2-D sample carries twice
+	// as many fraction bits and still fits in 32 bits for bicubic overshoot.
+	const int WeightBits = 11;
+	// Total size of the cached lens tables, at 6 bytes per pixel. The newest
+	// table is kept even when it alone is larger.
+	const size_t MaxCachedLensBytes = size_t(256) << 20;
+	const double Pi = 3.14159265358979323846;
+
+	struct LensTableEntry {
+		LensProfile profile;
+		int width;
+		int height;
+		std::shared_ptr<const RemapTable> table;
+	};
+
+	// Nearest 1/32 pixel, clamped to the int16 range. Rounds with a cast
+	// instead of std::lround, which is a library call per pixel.
+	int toFixed(double v) {
+		const double limit = static_cast<double>(MaxWarpSide) * One;
+		v = std::min(std::max(v * One, -limit), limit) + 0.5;
+		const int truncated = static_cast<int>(v);
+		return truncated > v ? truncated - 1 : truncated;
+	}
+
+	void storePosition(double x, double y, short* xy, unsigned short* fraction) {
+		const int fx = toFixed(x);
+		const int fy = toFixed(y);
+		xy[0] = static_cast<short>(fx >> WarpFractionBits);
+		xy[1] = static_cast<short>(fy >> WarpFractionBits);
+		*fraction = static_cast<unsigned short>(((fy & FractionMask) << WarpFractionBits) | (fx & FractionMask));
+	}
+
+	void transformRow(const WarpTransform& transform, int x0, int y, int count, short* xy, unsigned short* fraction) {
+		const std::array<double, 9>& m = transform.m;
+		const bool projective = m[6] != 0.0 || m[7] != 0.0 || m[8] != 1.0;
+		for (int i = 0; i < count; ++i) {
+			const double x = x0 + i;
+			double sx = m[0] * x + m[1] * y + m[2];
+			double sy = m[3] * x + m[4] * y + m[5];
+			if (projective) {
+				const double w = m[6] * x + m[7] * y + m[8];
+				// Points on or behind the horizon have no source pixel.
+				if (w <= 1e-12) {
+					sx = -1e9;
+					sy = -1e9;
+				}
+				else {
+					sx /= w;
+					sy /= w;
+				}
+			}
+			storePosition(sx, sy, xy + 2 * i, fraction + i);
+		}
+	}
+
+	double cubicWeight(double x) {
+		x = std::abs(x);
+		if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+		if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+		return 0.0;
+	}
+
+	unsigned char toByte(int sum) {
+		const int value = (sum + (1 << (2 * WeightBits - 1))) >> (2 * WeightBits);
+		return static_cast<unsigned char>(std::min(std::max(value, 0), 255));
+	}
+
+	class Sampler {
+	public:
+		Sampler(const unsigned char* src, int width, int height, int channels, WarpInterpolation interpolation, BorderMode border)
+			: src(src), width(width), height(height), channels(channels), border(border),
+			taps(interpolation == WarpInterpolation::Bicubic ? 4 : 2) {
+			for (int f = 0; f < One; ++f) {
+				int* w = weights[f];
+				if (taps == 2) {
+					w[0] = (One - f) << (WeightBits - WarpFractionBits);
+					w[1] = f << (WeightBits - WarpFractionBits);
+					continue;
+				}
+				const double t = static_cast<double>(f) / One;
+				int sum = 0;
+				int largest = 0;
+				for (int k = 0; k < 4; ++k) {
+					w[k] = static_cast<int>(std::lround(cubicWeight(k - 1 - t) * (1 << WeightBits)));
+					sum += w[k];
+					if (std::abs(w[k]) > std::abs(w[largest])) largest = k;
+				}
+				w[largest] += (1 << WeightBits) - sum;
+			}
+		}
+
+		void sampleRow(const short* xy, const unsigned short* fraction, int count, unsigned char* dst) const {
+			if (taps == 4) sampleTaps<4>(xy, fraction, count, dst);
+			else sampleTaps<2>(xy, fraction, count, dst);
+		}
+
+	private:
+		template <int Taps>
+		void sampleTaps(const short* xy, const unsigned short* fraction, int count, unsigned char* dst) const {
+			if (channels == 3) sample<Taps, 3>(xy, fraction, count, dst);
+			else if (channels == 4) sample<Taps, 4>(xy, fraction, count, dst);
+			else sample<Taps, 0>(xy, fraction, count, dst);
+		}
+
+		// Channels is 0 when only known at run time.
+		template <int Taps, int Channels>
+		void sample(const short* xy, const unsigned short* fraction, int count, unsigned char* dst) const {
+			const int channels = Channels ? Channels : this->channels;
+			const int first = Taps == 4 ? -1 : 0;
+			const size_t stride = static_cast<size_t>(width) * channels;
+			for (int i = 0; i < count; ++i) {
+				unsigned char* out = dst + static_cast<size_t>(i) * channels;
+				const int x = xy[2 * i] + first;
+				const int y = xy[2 * i + 1] + first;
+				const int* wx = weights[fraction[i] & FractionMask];
+				const int* wy = weights[fraction[i] >> WarpFractionBits];
+
+				if (x >= 0 && y >= 0 && x + Taps <= width && y + Taps <= height) {
+					const unsigned char* p = src + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * channels;
+					for (int c = 0; c < channels; ++c) {
+						int sum = 0;
+						for (int j = 0; j < Taps; ++j) {
+							const unsigned char* row = p + j * stride + c;
+							int rowSum = 0;
+							for (int k = 0; k < Taps; ++k) rowSum += wx[k] * row[k * channels];
+							sum += wy[j] * rowSum;
+						}
+						out[c] = toByte(sum);
+					}
+					continue;
+				}
+
+				if (border == BorderMode::Zero && (x + Taps <= 0 || y + Taps <= 0 || x >= width || y >= height)) {
+					std::fill(out, out + channels, static_cast<unsigned char>(0));
+					continue;
+				}
+				int columns[Taps];
+				int rows[Taps];
+				for (int k = 0; k < Taps; ++k) {
+					columns[k] = borderCoordinate(x + k, width, border);
+					rows[k] = borderCoordinate(y + k, height, border);
+				}
+				for (int c = 0; c < channels; ++c) {
+					int sum = 0;
+					for (int j = 0; j < Taps; ++j) {
+						if (rows[j] < 0) continue;
+						const unsigned char* row = src + static_cast<size_t>(rows[j]) * stride + c;
+						int rowSum = 0;
+						for (int k = 0; k < Taps; ++k) {
+							if (columns[k] >= 0) rowSum += wx[k] * row[static_cast<size_t>(columns[k]) * channels];
+						}
+						sum += wy[j] * rowSum;
+					}
+					out[c] = toByte(sum);
+				}
+			}
+		}
+
+		const unsigned char* src;
+		int width;
+		int height;
+		int channels;
+		BorderMode border;
+		int taps;
+		int weights[One][4];
+	};
+
+	// Runs the output in parallel tiles. positions(x0, y, count, xyBuffer,
+	// fractionBuffer, xy, fraction) points xy and fraction at the positions of
+	// the tile row, either in the buffers it filled or in a table.
+	template <typename Positions>
+	void warpTiles(const Sampler& sampler, unsigned char* dst, int dstWidth, int dstHeight, int channels, Positions positions) {
+		const int tilesX = (dstWidth + TileSize - 1) / TileSize;
+		const int tilesY = (dstHeight + TileSize - 1) / TileSize;
+		const int tiles = tilesX * tilesY;
+
+#pragma omp parallel
+		{
+			std::vector<short> xyBuffer(2 * TileSize);
+			std::vector<unsigned short> fractionBuffer(TileSize);
+
+#pragma omp for schedule(dynamic)
+			for (int t = 0; t < tiles; ++t) {
+				const int x0 = (t % tilesX) * TileSize;
+				const int y0 = (t / tilesX) * TileSize;
+				const int x1 = std::min(x0 + TileSize, dstWidth);
+				const int y1 = std::min(y0 + TileSize, dstHeight);
+				for (int y = y0; y < y1; ++y) {
+					const short* xy = nullptr;
+					const unsigned short* fraction = nullptr;
+					positions(x0, y, x1 - x0, xyBuffer.data(), fractionBuffer.data(), xy, fraction);
+					sampler.sampleRow(xy, fraction, x1 - x0, dst + (static_cast<size_t>(y) * dstWidth + x0) * channels);
+				}
+			}
+		}
+	}
+
+}
+
+const char* warpInterpolationName(WarpInterpolation interpolation) {
+	switch (interpolation) {
+	case WarpInterpolation::Bilinear: return "Bilinear";
+	case WarpInterpolation::Bicubic: return "Bicubic";
+	default: return "Unknown";
+	}
+}
+
+WarpTransform centeredLinearTransform(double a, double b, double c, double d, int srcWidth, int srcHeight,
+	int dstWidth, int dstHeight) {
+	const double determinant = a * d - b * c;
+	if (std::abs(determinant) < 1e-12) {
+		throw std::runtime_error("Singular warp transform");
+	}
+	const double ia = d / determinant;
+	const double ib = -b / determinant;
+	const double ic = -c / determinant;
+	const double id = a / determinant;
+	const double srcX = 0.5 * (srcWidth - 1);
+	const double srcY = 0.5 * (srcHeight - 1);
+	const double dstX = 0.5 * (dstWidth - 1);
+	const double dstY = 0.5 * (dstHeight - 1);
+
+	WarpTransform transform;
+	transform.m = { {
+		ia, ib, srcX - ia * dstX - ib * dstY,
+		ic, id, srcY - ic * dstX - id * dstY,
+		0.0, 0.0, 1.0 } };
+	return transform;
+}
+
+WarpTransform rotationTransform(double degrees, int srcWidth, int srcHeight, int dstWidth, int dstHeight) {
+	const double angle = degrees * Pi / 180.0;
+	const double cosine = std::cos(angle);
+	const double sine = std::sin(angle);
+	// y points down, so this turns counterclockwise on screen.
+	return centeredLinearTransform(cosine, sine, -sine, cosine, srcWidth, srcHeight, dstWidth, dstHeight);
+}
+
+void rotatedSize(double degrees, int width, int height, int& rotatedWidth, int& rotatedHeight) {
+	const double angle = degrees * Pi / 180.0;
+	const double cosine = std::abs(std::cos(angle));
+	const double sine = std::abs(std::sin(angle));
+	rotatedWidth = std::max(static_cast<int>(std::ceil(cosine * width + sine * height - 1e-6)), 1);
+	rotatedHeight = std::max(static_cast<int>(std::ceil(sine * width + cosine * height - 1e-6)), 1);
+}
+
+WarpTransform quadTransform(const std::array<double, 8>& corners, int dstWidth, int dstHeight) {
+	const double right = dstWidth - 1;
+	const double bottom = dstHeight - 1;
+	const double from[8] = { 0.0, 0.0, right, 0.0, right, bottom, 0.0, bottom };
+
+	// u = (h0 x + h1 y + h2) / (h6 x + h7 y + 1), v likewise with h3 h4 h5,
+	// two linear equations per corner.
+	double system[8][9];
+	for (int i = 0; i < 4; ++i) {
+		const double x = from[2 * i];
+		const double y = from[2 * i + 1];
+		const double u = corners[2 * i];
+		const double v = corners[2 * i + 1];
+		const double rowU[9] = { x, y, 1.0, 0.0, 0.0, 0.0, -x * u, -y * u, u };
+		const double rowV[9] = { 0.0, 0.0, 0.0, x, y, 1.0, -x * v, -y * v, v };
+		std::copy(rowU, rowU + 9, system[2 * i]);
+		std::copy(rowV, rowV + 9, system[2 * i + 1]);
+	}
+
+	for (int col = 0; col < 8; ++col) {
+		int pivot = col;
+		for (int r = col + 1; r < 8; ++r) {
+			if (std::abs(system[r][col]) > std::abs(system[pivot][col])) pivot = r;
+		}
+		if (std::abs(system[pivot][col]) < 1e-12) {
+			throw std::runtime_error("Singular warp transform");
+		}
+		std::swap(system[col], system[pivot]);
+		for (int r = 0; r < 8; ++r) {
+			if (r == col) continue;
+			const double factor = system[r][col] / system[col][col];
+			for (int c = col; c < 9; ++c) system[r][c] -= factor * system[col][c];
+		}
+	}
+
+	WarpTransform transform;
+	for (int i = 0; i < 8; ++i) transform.m[i] = system[i][8] / system[i][i];
+	transform.m[8] = 1.0;
+	return transform;
+}
+
+WarpTransform keystoneTransform(double horizontal, double vertical, int width, int height) {
+	const double right = width - 1;
+	const double bottom = height - 1;
+	std::array<double, 8> corners = { { 0.0, 0.0, right, 0.0, right, bottom, 0.0, bottom } };
+	const double insetX = 0.5 * std::abs(vertical) * right;
+	const double insetY = 0.5 * std::abs(horizontal) * bottom;
+	// Corners 0 and 1 are the top edge, 3 and 2 the bottom one.
+	const int edgeLeft = vertical > 0.0 ? 0 : 3;
+	const int edgeRight = vertical > 0.0 ? 1 : 2;
+	corners[2 * edgeLeft] += insetX;
+	corners[2 * edgeRight] -= insetX;
+	// 0 and 3 are the left edge, 1 and 2 the right one.
+	const int edgeTop = horizontal > 0.0 ? 0 : 1;
+	const int edgeBottom = horizontal > 0.0 ? 3 : 2;
+	corners[2 * edgeTop + 1] += insetY;
+	corners[2 * edgeBottom + 1] -= insetY;
+	return quadTransform(corners, width, height);
+}
+
+void buildRemapTable(const WarpTransform& transform, int dstWidth, int dstHeight, RemapTable& table) {
+	table.width = dstWidth;
+	table.height = dstHeight;
+	table.xy.resize(static_cast<size_t>(dstWidth) * dstHeight * 2);
+	table.fraction.resize(static_cast<size_t>(dstWidth) * dstHeight);
+
+#pragma omp parallel for
+	for (int y = 0; y < dstHeight; ++y) {
+		const size_t offset = static_cast<size_t>(y) * dstWidth;
+		transformRow(transform, 0, y, dstWidth, table.xy.data() + 2 * offset, table.fraction.data() + offset);
+	}
+}
+
+void buildLensRemapTable(const LensProfile& profile, int width, int height, RemapTable& table) {
+	table.width = width;
+	table.height = height;
+	table.xy.resize(static_cast<size_t>(width) * height * 2);
+	table.fraction.resize(static_cast<size_t>(width) * height);
+	const double centerX = 0.5 * (width - 1);
+	const double centerY = 0.5 * (height - 1);
+	const double radius = std::max(0.5 * std::sqrt(static_cast<double>(width) * width + static_cast<double>(height) * height), 1.0);
+
+#pragma omp parallel for
+	for (int y = 0; y < height; ++y) {
+		const double ny = (y - centerY) / radius;
+		const size_t offset = static_cast<size_t>(y) * width;
+		for (int x = 0; x < width; ++x) {
+			const double nx = (x - centerX) / radius;
+			const double r2 = nx * nx + ny * ny;
+			const double radial = 1.0 + r2 * (profile.k1 + r2 * profile.k2);
+			const double dx = nx * radial + 2.0 * profile.p1 * nx * ny + profile.p2 * (r2 + 2.0 * nx * nx);
+			const double dy = ny * radial + profile.p1 * (r2 + 2.0 * ny * ny) + 2.0 * profile.p2 * nx * ny;
+			storePosition(centerX + dx * radius, centerY + dy * radius, table.xy.data() + 2 * (offset + x), table.fraction.data() + offset + x);
+		}
+	}
+}
+
+std::shared_ptr<const RemapTable> lensRemapTable(const LensProfile& profile, int width, int height) {
+	static std::mutex mutex;
+	// Most recently used first.
+	static std::vector<LensTableEntry> entries;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (entries[i].profile == profile && entries[i].width == width && entries[i].height == height) {
+			std::rotate(entries.begin(), entries.begin() + i, entries.begin() + i + 1);
+			return entries.front().table;
+		}
+	}
+
+	std::shared_ptr<RemapTable> table = std::make_shared<RemapTable>();
+	buildLensRemapTable(profile, width, height, *table);
+	entries.insert(entries.begin(), LensTableEntry{ profile, width, height, table });
+	size_t bytes = 0;
+	for (const LensTableEntry& entry : entries) {
+		bytes += entry.table->xy.size() * sizeof(short) + entry.table->fraction.size() * sizeof(unsigned short);
+	}
+	while (entries.size() > 1 && bytes > MaxCachedLensBytes) {
+		const RemapTable& oldest = *entries.back().table;
+		bytes -= oldest.xy.size() * sizeof(short) + oldest.fraction.size() * sizeof(unsigned short);
+		entries.pop_back();
+	}
+	return table;
+}
+
+void warpImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+	unsigned char* dst, int dstWidth, int dstHeight, const WarpTransform& transform,
+	WarpInterpolation interpolation, BorderMode border) {
+	if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+	const Sampler sampler(src, srcWidth, srcHeight, channels, interpolation, border);
+	warpTiles(sampler, dst, dstWidth, dstHeight, channels,
+		[&](int x0, int y, int count, short* xyBuffer, unsigned short* fractionBuffer, const short*& xy, const unsigned short*& fraction) {
+			transformRow(transform, x0, y, count, xyBuffer, fractionBuffer);
+			xy = xyBuffer;
+			fraction = fractionBuffer;
+		});
+}
+
+void remapImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+	unsigned char* dst, const RemapTable& table, WarpInterpolation interpolation, BorderMode border) {
+	if (srcWidth <= 0 || srcHeight <= 0 || table.width <= 0 || table.height <= 0) return;
+	const Sampler sampler(src, srcWidth, srcHeight, channels, interpolation, border);
+	warpTiles(sampler, dst, table.width, table.height, channels,
+		[&](int x0, int y, int, short*, unsigned short*, const short*& xy, const unsigned short*& fraction) {
+			const size_t offset = static_cast<size_t>(y) * table.width + x0;
+			xy = table.xy.data() + 2 * offset;
+			fraction = table.fraction.data() + offset;
+		});
+}
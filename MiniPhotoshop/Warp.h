@@ -0,0 +1,101 @@
+#ifndef WARP_H
+#define WARP_H
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "Stencil3x3.h"
+
+// Source positions are kept in 1/32 pixel steps.
+const int WarpFractionBits = 5;
+// Integer source positions are 16 bits, so neither image may be larger.
+const int MaxWarpSide = 32767;
+
+enum class WarpInterpolation {
+    // 2x2 source pixels.
+    Bilinear = 0,
+    // 4x4 source pixels, Keys cubic with a = -0.5.
+    Bicubic,
+    Count
+};
+
+const char* warpInterpolationName(WarpInterpolation interpolation);
+
+// Row-major 3x3 matrix that takes an output pixel (x, y, 1) to the
+// homogeneous source position. Pixel centers are at integer coordinates.
+// Affine maps have the last row 0 0 1, which skips the division.
+struct WarpTransform {
+    std::array<double, 9> m{ { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 } };
+};
+
+// The linear map (a b; c d) from source to output applied about the image
+// centers, expressed as the output to source transform a warp needs.
+WarpTransform centeredLinearTransform(double a, double b, double c, double d, int srcWidth, int srcHeight,
+    int dstWidth, int dstHeight);
+
+// Counterclockwise on screen.
+WarpTransform rotationTransform(double degrees, int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+
+// Size that holds the whole image rotated by `degrees`.
+void rotatedSize(double degrees, int width, int height, int& rotatedWidth, int& rotatedHeight);
+
+// Perspective map of the output corners onto the source quad `corners`:
+// top-left, top-right, bottom-right and bottom-left as x, y pairs.
+WarpTransform quadTransform(const std::array<double, 8>& corners, int dstWidth, int dstHeight);
+
+// Keystone correction: a positive vertical amount samples the top edge from
+// a span that is narrower by that fraction of the width, which straightens
+// lines converging upwards; negative amounts narrow the bottom edge. The
+// horizontal amount does the same for the left (positive) and right edges.
+WarpTransform keystoneTransform(double horizontal, double vertical, int width, int height);
+
+// Brown-Conrady distortion about the image center, with coordinates scaled
+// so that the corners are at radius 1. Correction maps every pixel of the
+// undistorted output to where the lens put it.
+struct LensProfile {
+    // Radial terms: negative k1 is barrel distortion, positive pincushion.
+    float k1{ 0.0f };
+    float k2{ 0.0f };
+    // Tangential terms, for lenses that are not parallel to the sensor.
+    float p1{ 0.0f };
+    float p2{ 0.0f };
+
+    bool operator==(const LensProfile& other) const {
+        return k1 == other.k1 && k2 == other.k2 && p1 == other.p1 && p2 == other.p2;
+    }
+};
+
+// Source position of every output pixel in fixed point: xy holds the integer
+// pixel as x, y int16 pairs and fraction holds (fy << WarpFractionBits) | fx,
+// 6 bytes per pixel. A table does not depend on the pixels, only on the
+// transform and the image sizes, so it can be reused for every image of a
+// series.
+struct RemapTable {
+    int width{ 0 };
+    int height{ 0 };
+    std::vector<short> xy;
+    std::vector<unsigned short> fraction;
+};
+
+void buildRemapTable(const WarpTransform& transform, int dstWidth, int dstHeight, RemapTable& table);
+void buildLensRemapTable(const LensProfile& profile, int width, int height, RemapTable& table);
+
+// Table of buildLensRemapTable, shared by every caller and thread. The most
+// recently used profile and size combinations stay cached, up to 256 MB.
+std::shared_ptr<const RemapTable> lensRemapTable(const LensProfile& profile, int width, int height);
+
+// Both warps sample the interleaved 8-bit source at one fixed-point position
+// per output pixel, all channels alike; samples outside the source follow
+// `border`. The output is traversed in tiles that run in parallel, so the
+// source reads of a tile stay close together for any rotation.
+//
+// Positions come from the transform, computed per tile row.
+void warpImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+    unsigned char* dst, int dstWidth, int dstHeight, const WarpTransform& transform,
+    WarpInterpolation interpolation, BorderMode border);
+// Positions come from the table, the output has its size.
+void remapImage(const unsigned char* src, int srcWidth, int srcHeight, int channels,
+    unsigned char* dst, const RemapTable& table, WarpInterpolation interpolation, BorderMode border);
+
+#endif // WARP_H
@@ -5,6 +5,12 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -12,6 +18,8 @@
 
 #include "Shader.h"
 #include "Texture.h"
+#include "CpuDispatch.h"
+#include "Keypoint.h"
 
 #include <filesystem>
 #include "nfd.h"
@@ -22,6 +30,33 @@ unsigned int texture1;
 unsigned int texture2;
 float scale = 1.0f;
 
+// Harris corners of the modified image, strongest first. They are drawn as
+// an overlay and dropped as soon as the pixels change.
+std::vector<Keypoint> corners;
+unsigned long long cornerGeneration = ~0ULL;
+float cornerThreshold = 0.0f;
+const size_t maxDrawnCorners = 20000;
+
+// Non-local means of a small pyramid level, shown in place of the modified
+// image while the preview is on, until the pixels or the settings change.
+bool denoisePreview = false;
+unsigned int denoisePreviewTexture = 0;
+unsigned long long denoisePreviewGeneration = ~0ULL;
+const long long denoisePreviewPixels = 1 << 19;
+
+void uploadPreview(const ImageLevel& level) {
+    if (denoisePreviewTexture == 0) {
+        glGenTextures(1, &denoisePreviewTexture);
+        glBindTexture(GL_TEXTURE_2D, denoisePreviewTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    const GLenum format = level.channels == 4 ? GL_RGBA : GL_RGB;
+    glBindTexture(GL_TEXTURE_2D, denoisePreviewTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 void drawHistogram(const char* label, const std::array<int, 256>& values, int maxValue, ImVec4 color) {
     ImGui::PushID(label);
 
@@ -50,6 +85,40 @@ void drawHistogram(const char* label, const std::array<int, 256>& values, int ma
     ImGui::PopID();
 }
 
+void drawStatsPanel(const ImageStats& stats) {
+    const char* names[] = { "R", "G", "B", "Luma" };
+    const double toPercent = stats.pixelCount > 0 ? 100.0 / stats.pixelCount : 0.0;
+
+    if (ImGui::BeginTable("Stats", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp)) {
+        const char* headers[] = { "", "Min", "Max", "Mean", "Std", "0 %", "255 %" };
+        for (const char* header : headers) {
+            ImGui::TableSetupColumn(header);
+        }
+        ImGui::TableHeadersRow();
+
+        for (int c = 0; c < static_cast<int>(StatsChannel::Count); ++c) {
+            const ChannelStats& channel = stats.channel(static_cast<StatsChannel>(c));
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::TextUnformatted(names[c]);
+            ImGui::TableNextColumn(); ImGui::Text("%d", channel.min);
+            ImGui::TableNextColumn(); ImGui::Text("%d", channel.max);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", channel.mean);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", channel.stddev);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", channel.shadowClipped * toPercent);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", channel.highlightClipped * toPercent);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("Clipped pixels: %.2f%% shadows, %.2f%% highlights",
+        stats.anyShadowClipped * toPercent, stats.anyHighlightClipped * toPercent);
+    if (stats.exact) {
+        ImGui::Text("Exact");
+    }
+    else {
+        ImGui::Text("Sampled from %lld pixels, CDF within %.2f%% (95%%)", stats.pixelCount, stats.cdfErrorBound * 100.0);
+    }
+}
+
 void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTexture, GLFWwindow * window) {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -69,10 +138,24 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
     ImGui::GetStyle().AntiAliasedLines = false;
     ImGui::GetStyle().AntiAliasedFill = false;
     ImGui::Text("Gray Histogram");
-    modifiedTexture.calculateHistogram();
-    int maxValue = *std::max_element(modifiedTexture.grayHistogram.begin(), modifiedTexture.grayHistogram.end());
-    drawHistogram("Current", modifiedTexture.grayHistogram, maxValue, ImVec4(0.0f, 0.7f, 0.0f, 1.0f));
+    const ImageStats& stats = modifiedTexture.interactiveStats();
+    const std::array<int, 256>& grayHistogram = stats.histogram(StatsChannel::Luma);
+    int maxValue = *std::max_element(grayHistogram.begin(), grayHistogram.end());
+    drawHistogram("Current", grayHistogram, maxValue, ImVec4(0.0f, 0.7f, 0.0f, 1.0f));
     ImGui::PopStyleColor(2);
+    drawStatsPanel(stats);
+
+    const int activeLevel = static_cast<int>(activeSimdLevel());
+    const int detectedLevel = static_cast<int>(detectedSimdLevel());
+    if (ImGui::BeginCombo("SIMD path", simdLevelName(activeSimdLevel()))) {
+        for (int level = 0; level <= detectedLevel; ++level) {
+            if (ImGui::Selectable(simdLevelName(static_cast<SimdLevel>(level)), level == activeLevel)) {
+                setSimdLevel(static_cast<SimdLevel>(level));
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::Text("CPU supports up to %s", simdLevelName(detectedSimdLevel()));
 
     ImGui::Separator();
     if (ImGui::Button("Reset to Original", ImVec2(-1, 0))) {
@@ -84,6 +167,15 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
         if (ImGui::BeginTabItem("Basic Operations")) {
             ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.9f, 0.4f, 0.4f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(1.0f, 0.5f, 0.5f, 1.0f));
+            static int resizeWidth = 0;
+            static int resizeHeight = 0;
+            static int resizeSeenWidth = 0;
+            static int resizeSeenHeight = 0;
+            static unsigned long long resizeSeenGeneration = ~0ULL;
+            static bool keepAspect = true;
+            static ResizeFilter resizeFilter = ResizeFilter::Lanczos3;
+            const int maxResizeSide = 32768;
+
             ImGui::BeginTable("BasicOps", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
 
             ImGui::TableNextRow();
@@ -100,6 +192,143 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
                 modifiedTexture.updateTexture();
             }
 
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            const int currentWidth = static_cast<int>(modifiedTexture.getWidth());
+            const int currentHeight = static_cast<int>(modifiedTexture.getHeight());
+            // A new image or any edit starts the fields from the current size.
+            if (currentWidth != resizeSeenWidth || currentHeight != resizeSeenHeight
+                || modifiedTexture.getGeneration() != resizeSeenGeneration) {
+                resizeWidth = currentWidth;
+                resizeHeight = currentHeight;
+                resizeSeenWidth = currentWidth;
+                resizeSeenHeight = currentHeight;
+                resizeSeenGeneration = modifiedTexture.getGeneration();
+            }
+            ImGui::Text("Resize (now %d x %d)", currentWidth, currentHeight);
+            if (ImGui::InputInt("Width##resize", &resizeWidth)) {
+                resizeWidth = std::min(std::max(resizeWidth, 1), maxResizeSide);
+                if (keepAspect) resizeHeight = std::max(static_cast<int>(std::lround(resizeWidth * static_cast<double>(currentHeight) / currentWidth)), 1);
+            }
+            if (ImGui::InputInt("Height##resize", &resizeHeight)) {
+                resizeHeight = std::min(std::max(resizeHeight, 1), maxResizeSide);
+                if (keepAspect) resizeWidth = std::max(static_cast<int>(std::lround(resizeHeight * static_cast<double>(currentWidth) / currentHeight)), 1);
+            }
+            ImGui::Checkbox("Keep aspect ratio##resize", &keepAspect);
+            if (ImGui::BeginCombo("Filter##resize", resizeFilterName(resizeFilter))) {
+                for (int i = 0; i < static_cast<int>(ResizeFilter::Count); ++i) {
+                    const ResizeFilter filter = static_cast<ResizeFilter>(i);
+                    if (ImGui::Selectable(resizeFilterName(filter), filter == resizeFilter)) {
+                        resizeFilter = filter;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::Button("Resize", ImVec2(-1, 0))) {
+                modifiedTexture.resize(resizeWidth, resizeHeight, resizeFilter);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::EndTable();
+            ImGui::PopStyleColor(2);
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("Geometry")) {
+            ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.4f, 0.8f, 0.8f, 1.0f));
+            ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.5f, 0.9f, 0.9f, 1.0f));
+            static WarpInterpolation warpInterpolation = WarpInterpolation::Bicubic;
+            static float rotationDegrees = 0.0f;
+            static bool expandRotation = true;
+            static float affineScale[2] = { 1.0f, 1.0f };
+            static float affineShear[2] = { 0.0f, 0.0f };
+            static float keystone[2] = { 0.0f, 0.0f };
+            static LensProfile lensProfile;
+            static std::string warpError;
+            // Sizes outside 1..MaxWarpSide and singular maps throw before the
+            // image is touched; the message is shown below the buttons.
+            auto applyGeometry = [&](auto apply) {
+                try {
+                    apply();
+                    modifiedTexture.updateTexture();
+                    warpError.clear();
+                }
+                catch (const std::runtime_error& error) {
+                    warpError = error.what();
+                }
+            };
+
+            ImGui::BeginTable("Geometry", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::BeginCombo("Interpolation##warp", warpInterpolationName(warpInterpolation))) {
+                for (int i = 0; i < static_cast<int>(WarpInterpolation::Count); ++i) {
+                    const WarpInterpolation interpolation = static_cast<WarpInterpolation>(i);
+                    if (ImGui::Selectable(warpInterpolationName(interpolation), interpolation == warpInterpolation)) {
+                        warpInterpolation = interpolation;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            ImGui::Text("Samples outside the image follow the border mode");
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Rotate");
+            ImGui::SliderFloat("Degrees##rotate", &rotationDegrees, -180.0f, 180.0f, "%.1f");
+            ImGui::Checkbox("Expand to fit##rotate", &expandRotation);
+            if (ImGui::Button("Rotate", ImVec2(-1, 0))) {
+                applyGeometry([&] { modifiedTexture.rotate(rotationDegrees, expandRotation, warpInterpolation); });
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Affine");
+            ImGui::SliderFloat2("Scale##affine", affineScale, 0.1f, 4.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat2("Shear##affine", affineShear, -1.0f, 1.0f, "%.2f");
+            if (ImGui::Button("Apply Affine", ImVec2(-1, 0))) {
+                // Scale after a horizontal and a vertical shear, so the map
+                // stays invertible for any slider values.
+                const double a = affineScale[0] * (1.0 + affineShear[0] * affineShear[1]);
+                const double b = affineScale[0] * affineShear[0];
+                const double c = affineScale[1] * affineShear[1];
+                const double d = affineScale[1];
+                const int width = static_cast<int>(modifiedTexture.getWidth());
+                const int height = static_cast<int>(modifiedTexture.getHeight());
+                applyGeometry([&] {
+                    modifiedTexture.applyWarp(centeredLinearTransform(a, b, c, d, width, height, width, height), width, height, warpInterpolation);
+                });
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Perspective (keystone)");
+            ImGui::SliderFloat("Vertical##keystone", &keystone[1], -0.8f, 0.8f, "%.2f");
+            ImGui::SliderFloat("Horizontal##keystone", &keystone[0], -0.8f, 0.8f, "%.2f");
+            if (ImGui::Button("Apply Perspective", ImVec2(-1, 0))) {
+                const int width = static_cast<int>(modifiedTexture.getWidth());
+                const int height = static_cast<int>(modifiedTexture.getHeight());
+                if (width > 1 && height > 1) {
+                    applyGeometry([&] {
+                        modifiedTexture.applyWarp(keystoneTransform(keystone[0], keystone[1], width, height), width, height, warpInterpolation);
+                    });
+                }
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Lens Correction");
+            ImGui::SliderFloat("k1##lens", &lensProfile.k1, -0.5f, 0.5f, "%.3f");
+            ImGui::SliderFloat("k2##lens", &lensProfile.k2, -0.5f, 0.5f, "%.3f");
+            ImGui::SliderFloat("p1##lens", &lensProfile.p1, -0.1f, 0.1f, "%.3f");
+            ImGui::SliderFloat("p2##lens", &lensProfile.p2, -0.1f, 0.1f, "%.3f");
+            if (ImGui::Button("Correct Lens", ImVec2(-1, 0))) {
+                applyGeometry([&] { modifiedTexture.applyLensCorrection(lensProfile, warpInterpolation); });
+            }
+            if (!warpError.empty()) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", warpError.c_str());
+            }
+
             ImGui::EndTable();
             ImGui::PopStyleColor(2);
             ImGui::EndTabItem();
@@ -130,6 +359,18 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
                 modifiedTexture.updateTexture();
             }
 
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            static float autoLevelsClip = 0.5f;
+            static bool autoLevelsPerChannel = true;
+            ImGui::Text("Auto Levels");
+            ImGui::SliderFloat("Clip %##autolevels", &autoLevelsClip, 0.0f, 5.0f, "%.2f");
+            ImGui::Checkbox("Per channel##autolevels", &autoLevelsPerChannel);
+            if (ImGui::Button("Apply Auto Levels", ImVec2(-1, 0))) {
+                modifiedTexture.applyAutoLevels(autoLevelsClip, autoLevelsPerChannel);
+                modifiedTexture.updateTexture();
+            }
+
             ImGui::EndTable();
             ImGui::PopStyleColor(2);
             ImGui::Spacing();
@@ -150,6 +391,27 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
                 modifiedTexture.updateTexture();
             }
 
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::Button("Per-channel Equalization", ImVec2(-1, 0))) {
+                modifiedTexture.applyChannelHistogramEqualization();
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            static int claheTiles[2] = { 8, 8 };
+            static float claheClip = 2.0f;
+            static int claheMode = static_cast<int>(ClaheMode::Luminance);
+            const char* claheModes[] = { "Luminance", "Per channel" };
+            ImGui::SliderInt2("Tiles##clahe", claheTiles, 1, 32);
+            ImGui::SliderFloat("Clip limit##clahe", &claheClip, 0.0f, 10.0f, "%.1f");
+            ImGui::Combo("Mode##clahe", &claheMode, claheModes, IM_ARRAYSIZE(claheModes));
+            if (ImGui::Button("CLAHE", ImVec2(-1, 0))) {
+                modifiedTexture.applyClahe(claheTiles[0], claheTiles[1], claheClip, static_cast<ClaheMode>(claheMode));
+                modifiedTexture.updateTexture();
+            }
+
             ImGui::EndTable();
             ImGui::EndTabItem();
         }
@@ -159,6 +421,21 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
             ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.8f, 1.0f, 0.8f, 1.0f));
             static int boxSize = 3;
             static int gaussianSize = 5;
+            static float recursiveSigma = 10.0f;
+            static float bilateralSpatial = 16.0f;
+            static float bilateralRange = 25.0f;
+            static int guidedRadius = 8;
+            static float guidedEpsilon = 0.1f;
+            static float guidedDetail = 0.0f;
+            static int lensRadius = 15;
+            static int rankRadius = 1;
+            static int rankMode = 0;
+            static float rankPercentile = 50.0f;
+            static NonLocalMeansParameters denoiseParams;
+            static DiffusionParameters diffusionParams;
+            static float unsharpAmount = 1.0f;
+            static float unsharpRadius = 1.0f;
+            static int unsharpThreshold = 0;
 
             ImGui::BeginTable("Filters", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
 
@@ -180,14 +457,309 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
                 modifiedTexture.updateTexture();
             }
 
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Bilateral Filter");
+            ImGui::SliderFloat("Spatial sigma##bilateral", &bilateralSpatial, 2.0f, 128.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Range sigma##bilateral", &bilateralRange, 2.0f, 128.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            if (ImGui::Button("Apply Bilateral", ImVec2(-1, 0))) {
+                modifiedTexture.applyBilateralFilter(bilateralSpatial, bilateralRange);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Guided Filter");
+            ImGui::SliderInt("Radius##guided", &guidedRadius, 1, 64);
+            ImGui::SliderFloat("Epsilon##guided", &guidedEpsilon, 0.01f, 1.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Detail##guided", &guidedDetail, 0.0f, 5.0f, "%.1f");
+            if (ImGui::Button("Apply Guided Filter", ImVec2(-1, 0))) {
+                modifiedTexture.applyGuidedFilter(guidedRadius, guidedEpsilon, guidedDetail);
+                modifiedTexture.updateTexture();
+            }
+            ImGui::BeginDisabled(modifiedTexture.getNrChannel() != 4);
+            if (ImGui::Button("Refine Alpha Matte", ImVec2(-1, 0))) {
+                modifiedTexture.refineAlphaMatte(guidedRadius, guidedEpsilon);
+                modifiedTexture.updateTexture();
+            }
+            ImGui::EndDisabled();
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Anisotropic Diffusion");
+            ImGui::SliderInt("Iterations##diffusion", &diffusionParams.iterations, 1, 100);
+            ImGui::SliderFloat("Kappa##diffusion", &diffusionParams.kappa, 1.0f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            if (ImGui::BeginCombo("Conduction##diffusion", diffusionConductionName(diffusionParams.conduction))) {
+                for (int i = 0; i < static_cast<int>(DiffusionConduction::Count); ++i) {
+                    const DiffusionConduction conduction = static_cast<DiffusionConduction>(i);
+                    if (ImGui::Selectable(diffusionConductionName(conduction), conduction == diffusionParams.conduction)) {
+                        diffusionParams.conduction = conduction;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::Button("Apply Diffusion", ImVec2(-1, 0))) {
+                modifiedTexture.applyAnisotropicDiffusion(diffusionParams);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Non-Local Means");
+            bool denoiseEdited = false;
+            ImGui::SliderFloat("Strength##nlm", &denoiseParams.strength, 1.0f, 50.0f, "%.1f");
+            denoiseEdited |= ImGui::IsItemDeactivatedAfterEdit();
+            ImGui::SliderInt("Patch radius##nlm", &denoiseParams.patchRadius, 1, 5);
+            denoiseEdited |= ImGui::IsItemDeactivatedAfterEdit();
+            ImGui::SliderInt("Search radius##nlm", &denoiseParams.searchRadius, 2, 15);
+            denoiseEdited |= ImGui::IsItemDeactivatedAfterEdit();
+            denoiseEdited |= ImGui::Checkbox("Preview##nlm", &denoisePreview);
+            if (denoisePreview && (denoiseEdited || denoisePreviewGeneration != modifiedTexture.getGeneration())) {
+                uploadPreview(modifiedTexture.nonLocalMeansPreview(denoiseParams, denoisePreviewPixels));
+                denoisePreviewGeneration = modifiedTexture.getGeneration();
+            }
+            if (ImGui::Button("Apply Non-Local Means", ImVec2(-1, 0))) {
+                modifiedTexture.applyNonLocalMeans(denoiseParams);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Unsharp Mask");
+            ImGui::SliderFloat("Amount##unsharp", &unsharpAmount, 0.0f, 5.0f, "%.2f");
+            ImGui::SliderFloat("Radius##unsharp", &unsharpRadius, 0.3f, 50.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderInt("Threshold##unsharp", &unsharpThreshold, 0, 255);
+            if (ImGui::Button("Apply Unsharp Mask", ImVec2(-1, 0))) {
+                modifiedTexture.applyUnsharpMask(unsharpAmount, unsharpRadius, unsharpThreshold);
+                modifiedTexture.updateTexture();
+            }
+            if (ImGui::Button("High Pass", ImVec2(-1, 0))) {
+                modifiedTexture.applyHighPass(unsharpRadius);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Recursive Gaussian");
+            ImGui::SliderFloat("Sigma##recursive", &recursiveSigma, 0.5f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+            if (ImGui::Button("Apply Recursive Gaussian", ImVec2(-1, 0))) {
+                modifiedTexture.applyRecursiveGaussian(recursiveSigma);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Lens Blur");
+            ImGui::SliderInt("Radius##lens", &lensRadius, 1, 100);
+            if (ImGui::Button("Apply Lens Blur", ImVec2(-1, 0))) {
+                modifiedTexture.applyLensBlur(lensRadius);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("Median / Rank Filter");
+            ImGui::SliderInt("Radius##rank", &rankRadius, 1, 50);
+            const char* rankModes[] = { "Median", "Minimum", "Maximum", "Percentile" };
+            ImGui::Combo("Rank##rank", &rankMode, rankModes, IM_ARRAYSIZE(rankModes));
+            if (rankMode == 3) {
+                ImGui::SliderFloat("Percentile##rank", &rankPercentile, 0.0f, 100.0f, "%.0f");
+            }
+            if (ImGui::Button("Apply Rank Filter", ImVec2(-1, 0))) {
+                const float percentiles[] = { 50.0f, 0.0f, 100.0f, rankPercentile };
+                modifiedTexture.applyRankFilter(rankRadius, percentiles[rankMode]);
+                modifiedTexture.updateTexture();
+            }
+
+            ImGui::EndTable();
+            ImGui::PopStyleColor(2);
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("Morphology")) {
+            ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.8f, 0.6f, 0.4f, 1.0f));
+            ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(1.0f, 0.8f, 0.6f, 1.0f));
+            static int morphologyOperation = static_cast<int>(MorphologyOperation::Open);
+            static int structuringShape = static_cast<int>(StructuringShape::Rectangle);
+            static int morphologyRadiusX = 1;
+            static int morphologyRadiusY = 1;
+
+            ImGui::BeginTable("Morphology", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::BeginCombo("Operation##morphology", morphologyOperationName(static_cast<MorphologyOperation>(morphologyOperation)))) {
+                for (int o = 0; o < static_cast<int>(MorphologyOperation::Count); ++o) {
+                    if (ImGui::Selectable(morphologyOperationName(static_cast<MorphologyOperation>(o)), o == morphologyOperation)) {
+                        morphologyOperation = o;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::BeginCombo("Element##morphology", structuringShapeName(static_cast<StructuringShape>(structuringShape)))) {
+                for (int e = 0; e < static_cast<int>(StructuringShape::Count); ++e) {
+                    if (ImGui::Selectable(structuringShapeName(static_cast<StructuringShape>(e)), e == structuringShape)) {
+                        structuringShape = e;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            const bool rectangle = structuringShape == static_cast<int>(StructuringShape::Rectangle);
+            ImGui::SliderInt(rectangle ? "Radius X##morphology" : "Radius##morphology", &morphologyRadiusX, 1, 100);
+            if (rectangle) {
+                ImGui::SliderInt("Radius Y##morphology", &morphologyRadiusY, 0, 100);
+            }
+            if (ImGui::Button("Apply Morphology", ImVec2(-1, 0))) {
+                modifiedTexture.applyMorphology(static_cast<MorphologyOperation>(morphologyOperation),
+                    static_cast<StructuringShape>(structuringShape), morphologyRadiusX, morphologyRadiusY);
+                modifiedTexture.updateTexture();
+            }
+
             ImGui::EndTable();
             ImGui::PopStyleColor(2);
             ImGui::EndTabItem();
         }
 
+        if (ImGui::BeginTabItem("Threshold")) {
+            ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.6f, 0.6f, 0.6f, 1.0f));
+            ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.8f, 0.8f, 0.8f, 1.0f));
+            static int thresholdMethod = static_cast<int>(ThresholdMethod::Otsu);
+            static int thresholdRadius = 15;
+            static float thresholdK = 0.34f;
+            static int otsuValue = 0;
+            static unsigned long long otsuGeneration = ~0ULL;
+
+            ImGui::BeginTable("Threshold", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            if (ImGui::BeginCombo("Method##threshold", thresholdMethodName(static_cast<ThresholdMethod>(thresholdMethod)))) {
+                for (int m = 0; m < static_cast<int>(ThresholdMethod::Count); ++m) {
+                    if (ImGui::Selectable(thresholdMethodName(static_cast<ThresholdMethod>(m)), m == thresholdMethod)) {
+                        thresholdMethod = m;
+                        if (m == static_cast<int>(ThresholdMethod::Niblack)) thresholdK = -0.2f;
+                        if (m == static_cast<int>(ThresholdMethod::Sauvola)) thresholdK = 0.34f;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (thresholdMethod == static_cast<int>(ThresholdMethod::Otsu)) {
+                // Needs the exact histogram, so it is computed once per edit.
+                if (otsuGeneration != modifiedTexture.getGeneration()) {
+                    otsuValue = modifiedTexture.otsuThreshold();
+                    otsuGeneration = modifiedTexture.getGeneration();
+                }
+                ImGui::Text("Otsu threshold: %d", otsuValue);
+            }
+            else {
+                ImGui::SliderInt("Window radius##threshold", &thresholdRadius, 1, MaxThresholdRadius);
+                ImGui::SliderFloat("k##threshold", &thresholdK, -1.0f, 1.0f, "%.2f");
+            }
+            if (ImGui::Button("Apply Threshold", ImVec2(-1, 0))) {
+                modifiedTexture.applyThreshold(static_cast<ThresholdMethod>(thresholdMethod), thresholdRadius, thresholdK);
+                modifiedTexture.updateTexture();
+            }
+            if (ImGui::Button("Export Mask (PBM)", ImVec2(-1, 0))) {
+                nfdchar_t* savePath = NULL;
+                if (NFD_SaveDialog("pbm", NULL, &savePath) == NFD_OKAY) {
+                    writeMaskPbm(savePath, modifiedTexture.thresholdMask(static_cast<ThresholdMethod>(thresholdMethod), thresholdRadius, thresholdK));
+                    free(savePath);
+                }
+            }
+
+            ImGui::EndTable();
+            ImGui::PopStyleColor(2);
+            ImGui::EndTabItem();
+        }
+
+        if (ImGui::BeginTabItem("Custom Kernel")) {
+            static char kernelText[4096] = "0 -1 0\n-1 5 -1\n0 -1 0";
+            static int preset = 0;
+            static bool normalizeKernel = false;
+            static float kernelOffset = 0.0f;
+            static int kernelStrategy = static_cast<int>(ConvolutionStrategy::Auto);
+            static std::string kernelError;
+            static std::string kernelReport;
+
+            const char* presets[] = { "Sharpen", "Emboss", "Horizontal edges", "Vertical edges", "Motion blur" };
+            if (ImGui::Combo("Preset##kernel", &preset, presets, IM_ARRAYSIZE(presets))) {
+                const char* presetTexts[] = {
+                    "0 -1 0\n-1 5 -1\n0 -1 0",
+                    "-2 -1 0\n-1 1 1\n0 1 2",
+                    "-1 -2 -1\n0 0 0\n1 2 1",
+                    "-1 0 1\n-2 0 2\n-1 0 1",
+                    "1 0 0 0 0 0 0\n0 1 0 0 0 0 0\n0 0 1 0 0 0 0\n0 0 0 1 0 0 0\n0 0 0 0 1 0 0\n0 0 0 0 0 1 0\n0 0 0 0 0 0 1",
+                };
+                std::snprintf(kernelText, sizeof(kernelText), "%s", presetTexts[preset]);
+                normalizeKernel = preset == 4;
+                kernelOffset = preset == 2 || preset == 3 ? 128.0f : 0.0f;
+            }
+
+            ImGui::Text("One row per line, values separated by spaces");
+            ImGui::InputTextMultiline("##kernel", kernelText, sizeof(kernelText), ImVec2(-1, 120));
+            if (ImGui::Button("Load Kernel", ImVec2(-1, 0))) {
+                nfdchar_t* kernelPath = NULL;
+                if (NFD_OpenDialog("txt,csv", NULL, &kernelPath) == NFD_OKAY) {
+                    std::ifstream file(kernelPath);
+                    std::stringstream contents;
+                    contents << file.rdbuf();
+                    std::snprintf(kernelText, sizeof(kernelText), "%s", contents.str().c_str());
+                    free(kernelPath);
+                }
+            }
+
+            ImGui::Checkbox("Divide by sum##kernel", &normalizeKernel);
+            ImGui::InputFloat("Offset##kernel", &kernelOffset, 1.0f, 16.0f, "%.1f");
+            if (ImGui::BeginCombo("Strategy##kernel", convolutionStrategyName(static_cast<ConvolutionStrategy>(kernelStrategy)))) {
+                for (int s = 0; s < static_cast<int>(ConvolutionStrategy::Count); ++s) {
+                    if (ImGui::Selectable(convolutionStrategyName(static_cast<ConvolutionStrategy>(s)), s == kernelStrategy)) {
+                        kernelStrategy = s;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            if (ImGui::Button("Apply Kernel", ImVec2(-1, 0))) {
+                ConvolutionKernel kernel;
+                if (parseKernel(kernelText, kernel, kernelError)) {
+                    float sum = 0.0f;
+                    for (float tap : kernel.taps) sum += tap;
+                    if (normalizeKernel && sum != 0.0f) {
+                        for (float& tap : kernel.taps) tap /= sum;
+                    }
+                    kernel.offset = kernelOffset;
+
+                    std::vector<float> column, row;
+                    const float rankOneError = rankOneApproximation(kernel, column, row);
+                    const auto start = std::chrono::steady_clock::now();
+                    const ConvolutionStrategy used = modifiedTexture.applyConvolution(kernel, static_cast<ConvolutionStrategy>(kernelStrategy));
+                    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    modifiedTexture.updateTexture();
+
+                    char report[160];
+                    std::snprintf(report, sizeof(report), "%dx%d kernel: %s in %.1f ms (rank-1 error %.3g)",
+                        kernel.width, kernel.height, convolutionStrategyName(used), milliseconds, rankOneError);
+                    kernelReport = report;
+                }
+            }
+            if (!kernelError.empty()) {
+                ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", kernelError.c_str());
+            }
+            else if (!kernelReport.empty()) {
+                ImGui::TextWrapped("%s", kernelReport.c_str());
+            }
+
+            ImGui::EndTabItem();
+        }
+
         if (ImGui::BeginTabItem("Edge Detection")) {
             ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.9f, 0.9f, 0.4f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(1.0f, 1.0f, 0.5f, 1.0f));
+            int borderMode = static_cast<int>(modifiedTexture.getBorderMode());
+            const char* borderModes[] = { "Replicate", "Reflect", "Zero" };
+            if (ImGui::Combo("Border##edges", &borderMode, borderModes, IM_ARRAYSIZE(borderModes))) {
+                modifiedTexture.setBorderMode(static_cast<BorderMode>(borderMode));
+            }
             ImGui::BeginTable("EdgeDetection", 1, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp);
 
             ImGui::TableNextRow();
@@ -211,6 +783,19 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
                 modifiedTexture.updateTexture();
             }
 
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            static float cannySigma = 1.4f;
+            static float cannyLow = 40.0f;
+            static float cannyHigh = 100.0f;
+            ImGui::SliderFloat("Sigma##canny", &cannySigma, 0.0f, 5.0f, "%.2f");
+            ImGui::SliderFloat("Low##canny", &cannyLow, 0.0f, 500.0f, "%.1f");
+            ImGui::SliderFloat("High##canny", &cannyHigh, 0.0f, 1000.0f, "%.1f");
+            if (ImGui::Button("Canny Edge Detection", ImVec2(-1, 0))) {
+                modifiedTexture.applyCannyEdgeDetection(cannySigma, cannyLow, std::max(cannyLow, cannyHigh));
+                modifiedTexture.updateTexture();
+            }
+
             ImGui::EndTable();
             ImGui::PopStyleColor(2);
             ImGui::EndTabItem();
@@ -219,13 +804,39 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
         if (ImGui::BeginTabItem("Feature Detection")) {
             ImGui::PushStyleColor(ImGuiCol_Header, ImVec4(0.7f, 0.7f, 0.9f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.9f, 0.9f, 1.0f, 1.0f));
-            static float cornerThreshold = 0;
             static float k = 0.04f;
+            static float windowSigma = 1.0f;
+            if (cornerGeneration != modifiedTexture.getGeneration()) {
+                corners.clear();
+            }
             ImGui::Text("Harris Corner Detection");
-            ImGui::SliderFloat("Threshold##harris", &cornerThreshold, 0, 100, "%.1f");
+            const float maxResponse = corners.empty() ? 100.0f : std::max(corners.front().response, 1.0f);
+            ImGui::SliderFloat("Threshold##harris", &cornerThreshold, 0.0f, maxResponse, "%.3g", ImGuiSliderFlags_Logarithmic);
             ImGui::SliderFloat("K##harris", &k, 0.04f, 0.06f, "%.4f");
+            ImGui::SliderFloat("Window sigma##harris", &windowSigma, 0.5f, 3.0f, "%.2f");
             if (ImGui::Button("Detect Corners", ImVec2(-1, 0))) {
-                modifiedTexture.detectCornersHarris(k, cornerThreshold);
+                // Keeps every positive local maximum; the threshold only
+                // selects a prefix of the sorted list afterwards.
+                corners = modifiedTexture.detectCornersHarris(k, 0.0f, windowSigma);
+                cornerGeneration = modifiedTexture.getGeneration();
+            }
+
+            const size_t visibleCorners = countAbove(corners, cornerThreshold);
+            ImGui::Text("%zu of %zu corners above threshold", visibleCorners, corners.size());
+            if (ImGui::Button("Export CSV##harris") && visibleCorners > 0) {
+                nfdchar_t* savePath = NULL;
+                if (NFD_SaveDialog("csv", NULL, &savePath) == NFD_OKAY) {
+                    writeKeypointsCsv(savePath, corners.data(), visibleCorners);
+                    free(savePath);
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Export Binary##harris") && visibleCorners > 0) {
+                nfdchar_t* savePath = NULL;
+                if (NFD_SaveDialog("bin", NULL, &savePath) == NFD_OKAY) {
+                    writeKeypointsBinary(savePath, corners.data(), visibleCorners);
+                    free(savePath);
+                }
             }
 
             ImGui::PopStyleColor(2);
@@ -241,7 +852,6 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
 
             if (result == NFD_OKAY) {
                 modifiedTexture.loadFromFile(outPath);
-                modifiedTexture.calculateHistogram();
                 originalTexture.loadFromFile(outPath);
                 originalTexture.updateTexture();
                 modifiedTexture.updateTexture();
@@ -282,13 +892,24 @@ void renderImageProcessingUI(Texture & modifiedTexture, Texture & originalTextur
         displayWidth = displayHeight * aspectRatio;
     }
 
-    ImGui::Text("Modified Image");
+    ImGui::Text(denoisePreview ? "Modified Image (denoise preview)" : "Modified Image");
 
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(5.0f, 5.0f));
     ImGui::PushStyleColor(ImGuiCol_Border, ImVec4(0.0f, 0.0f, 0.0f, 1.0f));
     ImGui::PushStyleColor(ImGuiCol_BorderShadow, ImVec4(0.0f, 0.0f, 0.0f, 0.0f));
 
-    ImGui::Image((ImTextureID)modifiedTexture.getTextureId(), ImVec2(displayWidth, displayHeight));
+    const bool showPreview = denoisePreview && denoisePreviewGeneration == modifiedTexture.getGeneration();
+    ImGui::Image((ImTextureID)(showPreview ? denoisePreviewTexture : modifiedTexture.getTextureId()), ImVec2(displayWidth, displayHeight));
+    if (!corners.empty() && cornerGeneration == modifiedTexture.getGeneration()) {
+        const ImVec2 origin = ImGui::GetItemRectMin();
+        const float toScreen = displayWidth / modifiedTexture.getWidth();
+        const size_t drawnCorners = std::min(countAbove(corners, cornerThreshold), maxDrawnCorners);
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        for (size_t i = 0; i < drawnCorners; ++i) {
+            const ImVec2 center(origin.x + (corners[i].x + 0.5f) * toScreen, origin.y + (corners[i].y + 0.5f) * toScreen);
+            drawList->AddRectFilled(ImVec2(center.x - 1.5f, center.y - 1.5f), ImVec2(center.x + 1.5f, center.y + 1.5f), IM_COL32(255, 0, 0, 255));
+        }
+    }
     ImGui::PopStyleColor(2);
     ImGui::PopStyleVar();
 
@@ -332,6 +953,13 @@ int main() {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330");
 
+    // Pixel rows are tightly packed, RGB images of any width (resized ones
+    // and previews) do not start their rows on 4-byte boundaries.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // Runs cpuid once and logs which kernel variant is in use.
+    activeSimdLevel();
+
     Texture originalTexture("city.jpg");
     Texture modifiedTexture("city.jpg");
 